@@ -1,55 +1,605 @@
+#include <stddef.h>
+#include <string.h>
 #include "buffer.h"
 
-// Creates a buffer with the given capacity
-buffer_t* buffer_create(size_t capacity)
+// Maps a monotonically increasing position onto a slot index
+static inline size_t buffer_slot(buffer_t* buffer, size_t pos)
+{
+    return pos & buffer->mask;
+}
+
+// Stamps the slots of count positions starting at pos with the time they were filled
+// Must be called before the positions are published to consumers
+static inline void buffer_stamp_in(buffer_t* buffer, size_t pos, size_t count)
+{
+    if (buffer->stamps) {
+        uint64_t now = histogram_now();
+        for (size_t i = 0; i < count; i++) {
+            buffer->stamps[buffer_slot(buffer, pos + i)] = now;
+        }
+    }
+}
+
+// Records how long the values of count positions starting at pos sat in the buffer
+// Must be called before the positions are handed back to producers
+static inline void buffer_stamp_out(buffer_t* buffer, size_t pos, size_t count)
+{
+    if (buffer->stamps) {
+        uint64_t now = histogram_now();
+        for (size_t i = 0; i < count; i++) {
+            histogram_record(buffer->sojourn, now - buffer->stamps[buffer_slot(buffer, pos + i)]);
+        }
+    }
+}
+
+// Returns the value latest holds while a conflating buffer is empty, an address no caller
+// can have a value at
+static inline void* buffer_conflate_empty(buffer_t* buffer)
 {
-    buffer_t* buffer = (buffer_t*) malloc(sizeof(buffer_t));
-    void** data  = (void**) malloc(capacity * sizeof(void*));
-    buffer->size = 0;
-    buffer->next = 0;
+    return (void*)&buffer->latest;
+}
+
+// Rounds size up to a multiple of the cache line
+static inline size_t buffer_align(size_t size)
+{
+    return (size + BUFFER_CACHE_LINE - 1) & ~(size_t)(BUFFER_CACHE_LINE - 1);
+}
+
+// Returns the address of the inline slot of position pos
+static inline char* buffer_value_slot(buffer_t* buffer, size_t pos)
+{
+    return buffer->values + buffer_slot(buffer, pos) * buffer->stride;
+}
+
+// Creates a buffer with the given capacity whose slots hold pointers (elem_size 0) or
+// values of elem_size bytes
+static buffer_t* buffer_allocate(size_t capacity, size_t elem_size)
+{
+    size_t slots = 2;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    // Header, sequence numbers and slots each start on their own cache line, and so does
+    // every inline slot
+    size_t header_size = buffer_align(sizeof(buffer_t));
+    size_t seq_size = buffer_align(slots * sizeof(atomic_size_t));
+    size_t stride = BUFFER_STRIDE(elem_size);
+    size_t data_size = elem_size ? slots * stride : buffer_align(slots * sizeof(void*));
+    char* memory = (char*) aligned_alloc(BUFFER_CACHE_LINE, header_size + seq_size + data_size);
+    if (!memory) {
+        return NULL;
+    }
+    buffer_t* buffer = (buffer_t*) memory;
+    atomic_size_t* seq = (atomic_size_t*) (memory + header_size);
+    for (size_t i = 0; i < slots; i++) {
+        atomic_init(&seq[i], i);
+    }
     buffer->capacity = capacity;
-    buffer->data = data;
+    buffer->slots = slots;
+    buffer->mask = slots - 1;
+    buffer->data = elem_size ? NULL : (void**) (memory + header_size + seq_size);
+    buffer->values = elem_size ? memory + header_size + seq_size : NULL;
+    buffer->elem_size = elem_size;
+    buffer->stride = stride;
+    buffer->seq = seq;
+    buffer->stamps = NULL;
+    buffer->sojourn = NULL;
+    atomic_init(&buffer->head, 0);
+    atomic_init(&buffer->tail, 0);
+    buffer->cached_head = 0;
+    buffer->cached_tail = 0;
+    atomic_init(&buffer->reserved, 0);
+    atomic_init(&buffer->latest, buffer_conflate_empty(buffer));
     return buffer;
 }
 
+// Creates a buffer with the given capacity
+buffer_t* buffer_create(size_t capacity)
+{
+    return buffer_allocate(capacity, 0);
+}
+
+// Creates a buffer with the given capacity whose slots hold values of elem_size bytes
+buffer_t* buffer_create_typed(size_t capacity, size_t elem_size)
+{
+    if (elem_size == 0) {
+        return NULL;
+    }
+    return buffer_allocate(capacity, elem_size);
+}
+
+// Publishes the value a producer wrote into the slot of the claimed position pos
+static inline void buffer_publish(buffer_t* buffer, size_t pos)
+{
+    buffer_stamp_in(buffer, pos, 1);
+    atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos)], pos + 1, memory_order_release);
+}
+
 // Adds the value into the buffer
 // Returns BUFFER_SUCCESS if the buffer is not full and value was added
 // Returns BUFFER_ERROR otherwise
 enum buffer_status buffer_add(buffer_t* buffer, void* data)
 {
-    if (buffer->size >= buffer->capacity) {
+    size_t pos;
+    if (buffer_claim_tail_fixed(buffer, buffer->capacity, buffer->slots, &pos) != BUFFER_SUCCESS) {
         return BUFFER_ERROR;
     }
-    size_t pos = buffer->next + buffer->size;
-    if (pos >= buffer->capacity) {
-        pos -= buffer->capacity;
-    }
-    buffer->data[pos] = data;
-    buffer->size++;
+    buffer->data[buffer_slot(buffer, pos)] = data;
+    buffer_publish(buffer, pos);
     return BUFFER_SUCCESS;
 }
 
+// Hands the slot of the claimed position pos back to producers without recording a sojourn time
+static inline void buffer_free_slot(buffer_t* buffer, size_t pos)
+{
+    atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos)], pos + buffer->slots, memory_order_release);
+}
+
+// Hands the slot of the claimed position pos back to producers once its value was read
+static inline void buffer_release(buffer_t* buffer, size_t pos)
+{
+    buffer_stamp_out(buffer, pos, 1);
+    buffer_free_slot(buffer, pos);
+}
+
 // Removes the value from the buffer in FIFO order and stores it in data
 // Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
 // Returns BUFFER_ERROR otherwise
 enum buffer_status buffer_remove(buffer_t* buffer, void **data)
 {
-    if (buffer->size > 0) {
-        *data = buffer->data[buffer->next];
-        buffer->size--;
-        buffer->next++;
-        if (buffer->next >= buffer->capacity) {
-            buffer->next -= buffer->capacity;
+    size_t pos;
+    if (buffer_claim_head_fixed(buffer, buffer->capacity, buffer->slots, &pos) != BUFFER_SUCCESS) {
+        return BUFFER_ERROR;
+    }
+    *data = buffer->data[buffer_slot(buffer, pos)];
+    buffer_release(buffer, pos);
+    return BUFFER_SUCCESS;
+}
+
+// Copies the elem_size bytes at value into the buffer
+// Returns BUFFER_SUCCESS if the buffer is not full and the value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_add_value(buffer_t* buffer, const void* value)
+{
+    size_t pos;
+    if (buffer_claim_tail_fixed(buffer, buffer->capacity, buffer->slots, &pos) != BUFFER_SUCCESS) {
+        return BUFFER_ERROR;
+    }
+    memcpy(buffer_value_slot(buffer, pos), value, buffer->elem_size);
+    buffer_publish(buffer, pos);
+    return BUFFER_SUCCESS;
+}
+
+// Removes the oldest value from the buffer and copies its elem_size bytes to value
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_remove_value(buffer_t* buffer, void* value)
+{
+    size_t pos;
+    if (buffer_claim_head_fixed(buffer, buffer->capacity, buffer->slots, &pos) != BUFFER_SUCCESS) {
+        return BUFFER_ERROR;
+    }
+    memcpy(value, buffer_value_slot(buffer, pos), buffer->elem_size);
+    buffer_release(buffer, pos);
+    return BUFFER_SUCCESS;
+}
+
+// Adds the value into the buffer, removing the oldest values to make room while it is full
+// Returns the number of values dropped
+size_t buffer_overwrite_add(buffer_t* buffer, void* data)
+{
+    if (buffer->capacity == 0) {
+        return 0;
+    }
+    size_t dropped = 0;
+    while (buffer_add(buffer, data) != BUFFER_SUCCESS) {
+        // Drop the oldest value as a consumer would; if a consumer got there first the
+        // add is simply retried (a consumer halfway through a remove is waited out this way)
+        // A dropped value was never received, so it records no sojourn time
+        size_t pos;
+        if (buffer_claim_head_fixed(buffer, buffer->capacity, buffer->slots, &pos) == BUFFER_SUCCESS) {
+            buffer_free_slot(buffer, pos);
+            dropped++;
         }
-        return BUFFER_SUCCESS;
     }
-    return BUFFER_ERROR;
+    return dropped;
+}
+
+// Adds the value into the buffer when it is only ever written by one thread
+// and read by one thread (see buffer_spsc_remove)
+// Returns BUFFER_SUCCESS if the buffer is not full and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_spsc_add(buffer_t* buffer, void* data)
+{
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    if (tail - buffer->cached_head >= buffer->capacity) {
+        // Looks full from the cached head, refresh it from the consumer
+        buffer->cached_head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        if (tail - buffer->cached_head >= buffer->capacity) {
+            return BUFFER_ERROR;
+        }
+    }
+    buffer->data[buffer_slot(buffer, tail)] = data;
+    buffer_stamp_in(buffer, tail, 1);
+    atomic_store_explicit(&buffer->tail, tail + 1, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+// Removes the value from the buffer in FIFO order when it is only ever written by
+// one thread and read by one thread (see buffer_spsc_add)
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_spsc_remove(buffer_t* buffer, void** data)
+{
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    if (head == buffer->cached_tail) {
+        // Looks empty from the cached tail, refresh it from the producer
+        buffer->cached_tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+        if (head == buffer->cached_tail) {
+            return BUFFER_ERROR;
+        }
+    }
+    *data = buffer->data[buffer_slot(buffer, head)];
+    buffer_stamp_out(buffer, head, 1);
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+// Waits until the consumer handed the slot of the claimed position pos back (see
+// buffer_mpsc_remove); the reservation means it already has or is about to, but only this
+// acquire orders the producer's write of the slot after the consumer's read of the value
+// before it when the reservation was taken before that read
+static inline void buffer_mpsc_wait_slot(buffer_t* buffer, size_t pos)
+{
+    atomic_size_t* seq = &buffer->seq[buffer_slot(buffer, pos)];
+    while (atomic_load_explicit(seq, memory_order_acquire) != pos) {
+        buffer_cpu_relax();
+    }
+}
+
+// Reserves room for up to count values of a multi-producer/single-consumer buffer
+// Only increments reserved while it stays within capacity, so a producer that finds the
+// buffer full never changes it and cannot make a concurrent reservation fail spuriously
+// Returns the number of values reserved, 0 if the buffer is full
+static size_t buffer_mpsc_reserve(buffer_t* buffer, size_t count)
+{
+    size_t reserved = atomic_load(&buffer->reserved);
+    size_t granted;
+    do {
+        if (reserved >= buffer->capacity) {
+            return 0;
+        }
+        granted = buffer->capacity - reserved;
+        if (granted > count) {
+            granted = count;
+        }
+    } while (!atomic_compare_exchange_weak(&buffer->reserved, &reserved, reserved + granted));
+    return granted;
+}
+
+// Adds the value into the buffer when any number of threads write it but only
+// one thread reads it (see buffer_mpsc_remove)
+// Returns BUFFER_SUCCESS if the buffer is not full and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_mpsc_add(buffer_t* buffer, void* data)
+{
+    // Reserve room first; reserved only drops once the consumer is done with a
+    // slot, so the position claimed below is guaranteed to be free
+    if (buffer_mpsc_reserve(buffer, 1) == 0) {
+        return BUFFER_ERROR;
+    }
+    size_t pos = atomic_fetch_add_explicit(&buffer->tail, 1, memory_order_relaxed);
+    buffer_mpsc_wait_slot(buffer, pos);
+    buffer->data[buffer_slot(buffer, pos)] = data;
+    buffer_stamp_in(buffer, pos, 1);
+    atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos)], pos + 1, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+// Removes the value from the buffer in FIFO order when any number of threads
+// write it but only one thread reads it (see buffer_mpsc_add)
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_mpsc_remove(buffer_t* buffer, void** data)
+{
+    if (buffer->capacity == 0) {
+        return BUFFER_ERROR;
+    }
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    atomic_size_t* seq = &buffer->seq[buffer_slot(buffer, head)];
+    if (atomic_load_explicit(seq, memory_order_acquire) != head + 1) {
+        return BUFFER_ERROR;
+    }
+    *data = buffer->data[buffer_slot(buffer, head)];
+    buffer_stamp_out(buffer, head, 1);
+    atomic_store_explicit(seq, head + buffer->slots, memory_order_release);
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+    atomic_fetch_sub(&buffer->reserved, 1);
+    return BUFFER_SUCCESS;
+}
+
+// Copies count values into the slots of positions pos, pos + 1, ...
+// The slots wrap around at most once, so this is at most two memcpy calls
+static void buffer_copy_in(buffer_t* buffer, size_t pos, void** data, size_t count)
+{
+    size_t slot = buffer_slot(buffer, pos);
+    size_t first = buffer->slots - slot;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(&buffer->data[slot], data, first * sizeof(void*));
+    memcpy(&buffer->data[0], data + first, (count - first) * sizeof(void*));
+    buffer_stamp_in(buffer, pos, count);
+}
+
+// Copies the values of count slots starting at position pos out into data
+static void buffer_copy_out(buffer_t* buffer, size_t pos, void** data, size_t count)
+{
+    size_t slot = buffer_slot(buffer, pos);
+    size_t first = buffer->slots - slot;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(data, &buffer->data[slot], first * sizeof(void*));
+    memcpy(data + first, &buffer->data[0], (count - first) * sizeof(void*));
+    buffer_stamp_out(buffer, pos, count);
+}
+
+// Adds up to count values into the buffer
+// Returns the number of values added
+size_t buffer_add_many(buffer_t* buffer, void** data, size_t count)
+{
+    if (buffer->capacity == 0 || count == 0) {
+        return 0;
+    }
+    size_t pos = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    while (1) {
+        size_t limit = count;
+        if (buffer->slots != buffer->capacity) {
+            size_t used = pos - atomic_load_explicit(&buffer->head, memory_order_acquire);
+            if (used >= buffer->capacity) {
+                return 0;
+            }
+            if (limit > buffer->capacity - used) {
+                limit = buffer->capacity - used;
+            }
+        }
+        // Count the consecutive free slots; only a producer that claims their
+        // positions can change them, and that requires moving tail past pos first
+        size_t free = 0;
+        while (free < limit &&
+               atomic_load_explicit(&buffer->seq[buffer_slot(buffer, pos + free)], memory_order_acquire) == pos + free) {
+            free++;
+        }
+        if (free == 0) {
+            ptrdiff_t diff = (ptrdiff_t)(atomic_load_explicit(&buffer->seq[buffer_slot(buffer, pos)], memory_order_acquire) - pos);
+            if (diff < 0) {
+                return 0;
+            }
+            pos = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&buffer->tail, &pos, pos + free,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            buffer_copy_in(buffer, pos, data, free);
+            for (size_t i = 0; i < free; i++) {
+                atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos + i)], pos + i + 1, memory_order_release);
+            }
+            return free;
+        }
+    }
+}
+
+// Removes up to count values from the buffer
+// Returns the number of values removed
+size_t buffer_remove_many(buffer_t* buffer, void** data, size_t count)
+{
+    if (buffer->capacity == 0 || count == 0) {
+        return 0;
+    }
+    size_t pos = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    while (1) {
+        size_t full = 0;
+        while (full < count &&
+               atomic_load_explicit(&buffer->seq[buffer_slot(buffer, pos + full)], memory_order_acquire) == pos + full + 1) {
+            full++;
+        }
+        if (full == 0) {
+            ptrdiff_t diff = (ptrdiff_t)(atomic_load_explicit(&buffer->seq[buffer_slot(buffer, pos)], memory_order_acquire) - (pos + 1));
+            if (diff < 0) {
+                return 0;
+            }
+            pos = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&buffer->head, &pos, pos + full,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            buffer_copy_out(buffer, pos, data, full);
+            for (size_t i = 0; i < full; i++) {
+                atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos + i)], pos + i + buffer->slots, memory_order_release);
+            }
+            return full;
+        }
+    }
+}
+
+// Adds up to count values into a single-producer/single-consumer buffer
+// Returns the number of values added
+size_t buffer_spsc_add_many(buffer_t* buffer, void** data, size_t count)
+{
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    if (tail - buffer->cached_head + count > buffer->capacity) {
+        buffer->cached_head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    }
+    size_t free = buffer->capacity - (tail - buffer->cached_head);
+    if (count > free) {
+        count = free;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    buffer_copy_in(buffer, tail, data, count);
+    atomic_store_explicit(&buffer->tail, tail + count, memory_order_release);
+    return count;
+}
+
+// Removes up to count values from a single-producer/single-consumer buffer
+// Returns the number of values removed
+size_t buffer_spsc_remove_many(buffer_t* buffer, void** data, size_t count)
+{
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    if (buffer->cached_tail - head < count) {
+        buffer->cached_tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    }
+    size_t available = buffer->cached_tail - head;
+    if (count > available) {
+        count = available;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    buffer_copy_out(buffer, head, data, count);
+    atomic_store_explicit(&buffer->head, head + count, memory_order_release);
+    return count;
+}
+
+// Adds up to count values into a multi-producer/single-consumer buffer
+// Returns the number of values added
+size_t buffer_mpsc_add_many(buffer_t* buffer, void** data, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    count = buffer_mpsc_reserve(buffer, count);
+    if (count == 0) {
+        return 0;
+    }
+    size_t pos = atomic_fetch_add_explicit(&buffer->tail, count, memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        buffer_mpsc_wait_slot(buffer, pos + i);
+    }
+    buffer_copy_in(buffer, pos, data, count);
+    for (size_t i = 0; i < count; i++) {
+        atomic_store_explicit(&buffer->seq[buffer_slot(buffer, pos + i)], pos + i + 1, memory_order_release);
+    }
+    return count;
+}
+
+// Removes up to count values from a multi-producer/single-consumer buffer
+// Returns the number of values removed
+size_t buffer_mpsc_remove_many(buffer_t* buffer, void** data, size_t count)
+{
+    if (buffer->capacity == 0) {
+        return 0;
+    }
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    size_t full = 0;
+    while (full < count &&
+           atomic_load_explicit(&buffer->seq[buffer_slot(buffer, head + full)], memory_order_acquire) == head + full + 1) {
+        full++;
+    }
+    if (full == 0) {
+        return 0;
+    }
+    buffer_copy_out(buffer, head, data, full);
+    for (size_t i = 0; i < full; i++) {
+        atomic_store_explicit(&buffer->seq[buffer_slot(buffer, head + i)], head + i + buffer->slots, memory_order_release);
+    }
+    atomic_store_explicit(&buffer->head, head + full, memory_order_release);
+    atomic_fetch_sub(&buffer->reserved, full);
+    return full;
+}
+
+// Adds the value to a broadcast buffer
+// Returns BUFFER_SUCCESS if fewer than capacity values are ahead of head and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_broadcast_add(buffer_t* buffer, void* data)
+{
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    if (buffer->capacity == 0 ||
+        tail - atomic_load_explicit(&buffer->head, memory_order_acquire) >= buffer->capacity) {
+        return BUFFER_ERROR;
+    }
+    buffer->data[buffer_slot(buffer, tail)] = data;
+    atomic_store_explicit(&buffer->tail, tail + 1, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+// Reads the value at *cursor of a broadcast buffer and moves the cursor past it
+// Returns BUFFER_SUCCESS if a value was read
+// Returns BUFFER_ERROR if the cursor has caught up with tail
+enum buffer_status buffer_broadcast_read(buffer_t* buffer, atomic_size_t* cursor, void** data)
+{
+    size_t pos = atomic_load_explicit(cursor, memory_order_relaxed);
+    if (pos == atomic_load_explicit(&buffer->tail, memory_order_acquire)) {
+        return BUFFER_ERROR;
+    }
+    *data = buffer->data[buffer_slot(buffer, pos)];
+    // Sequentially consistent so that whoever computes the lowest cursor either sees the new
+    // position or is seen to have released up to the old one (see channel_broadcast_release)
+    atomic_store(cursor, pos + 1);
+    return BUFFER_SUCCESS;
+}
+
+// Returns the position the next value of a broadcast buffer is added at
+size_t buffer_broadcast_tail(buffer_t* buffer)
+{
+    return atomic_load_explicit(&buffer->tail, memory_order_acquire);
+}
+
+// Returns the position before which the values of a broadcast buffer may be overwritten
+size_t buffer_broadcast_head(buffer_t* buffer)
+{
+    return atomic_load(&buffer->head);
+}
+
+// Lets the values of a broadcast buffer before position head be overwritten
+void buffer_broadcast_release(buffer_t* buffer, size_t head)
+{
+    atomic_store(&buffer->head, head);
+}
+
+// Makes data the value of a conflating buffer
+// Returns true if it replaced a value that was never removed
+bool buffer_conflate_add(buffer_t* buffer, void* data)
+{
+    return atomic_exchange_explicit(&buffer->latest, data, memory_order_acq_rel) != buffer_conflate_empty(buffer);
+}
+
+// Removes the value of a conflating buffer and stores it in data
+// Returns BUFFER_SUCCESS if the buffer held a value
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_conflate_remove(buffer_t* buffer, void** data)
+{
+    void* empty = buffer_conflate_empty(buffer);
+    // Only exchange when there is something to take, so polling an empty buffer writes nothing
+    if (atomic_load_explicit(&buffer->latest, memory_order_relaxed) == empty) {
+        return BUFFER_ERROR;
+    }
+    void* value = atomic_exchange_explicit(&buffer->latest, empty, memory_order_acq_rel);
+    if (value == empty) {
+        return BUFFER_ERROR;
+    }
+    *data = value;
+    return BUFFER_SUCCESS;
+}
+
+// Starts recording how long each value sits in the buffer into histogram
+enum buffer_status buffer_record_sojourn(buffer_t* buffer, histogram_t* histogram)
+{
+    buffer->stamps = (uint64_t*) calloc(buffer->slots, sizeof(uint64_t));
+    if (!buffer->stamps) {
+        return BUFFER_ERROR;
+    }
+    buffer->sojourn = histogram;
+    return BUFFER_SUCCESS;
 }
 
 // Frees the memory allocated to the buffer
 void buffer_free(buffer_t *buffer)
 {
-    free(buffer->data);
+    // The slots live in the same allocation as the header, only the stamps do not
+    free(buffer->stamps);
     free(buffer);
 }
 
@@ -62,7 +612,15 @@ size_t buffer_capacity(buffer_t* buffer)
 // Returns the current number of elements in the buffer
 size_t buffer_current_size(buffer_t* buffer)
 {
-    return buffer->size;
+    // A conflating buffer holds its value in latest, a ring never does
+    if (atomic_load(&buffer->latest) != buffer_conflate_empty(buffer)) {
+        return 1;
+    }
+    // head is read first so that tail can never be observed behind it
+    size_t head = atomic_load(&buffer->head);
+    size_t tail = atomic_load(&buffer->tail);
+    size_t size = tail - head;
+    return size > buffer->capacity ? buffer->capacity : size;
 }
 
 // Peeks at a value in the buffer
@@ -2,12 +2,86 @@
 #define BUFFER_H
 
 #include <stdlib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "histogram.h"
 
+#define BUFFER_CACHE_LINE 64
+
+// Number of slots of a buffer with the given capacity: capacity rounded up to a power of two,
+// and at least two (for capacities up to 2^32)
+// A constant expression for a constant capacity, see the *_fixed functions below
+#define BUFFER_SLOTS(capacity) \
+    ((size_t)(capacity) <= 2 ? (size_t)2 : \
+     ((((size_t)(capacity) - 1) | (((size_t)(capacity) - 1) >> 1) | (((size_t)(capacity) - 1) >> 2) | \
+       (((size_t)(capacity) - 1) >> 4) | (((size_t)(capacity) - 1) >> 8) | (((size_t)(capacity) - 1) >> 16)) + 1))
+
+// Marks the inline functions whose constant arguments only fold if they are always inlined
+#if defined(__GNUC__)
+#define BUFFER_INLINE static inline __attribute__((always_inline))
+#else
+#define BUFFER_INLINE static inline
+#endif
+
+// Tells the cpu that this thread is busy-waiting
+BUFFER_INLINE void buffer_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Distance between the inline slots of a typed buffer: elem_size rounded up to the cache line
+#define BUFFER_STRIDE(elem_size) \
+    (((size_t)(elem_size) + BUFFER_CACHE_LINE - 1) & ~(size_t)(BUFFER_CACHE_LINE - 1))
+
+// Bounded multi-producer/multi-consumer ring
+// Every slot carries a sequence number so that producers and consumers can
+// claim positions with a single compare-and-swap on tail/head without a lock:
+//   seq == pos          the slot is free for the producer claiming pos
+//   seq == pos + 1      the slot holds the value written for pos
+//   seq == pos + slots  the value was consumed and the slot is free for pos + slots
+// head and tail only ever grow; the number of slots is rounded up to a power of
+// two (and at least two, which the scheme needs) so that a position maps onto
+// its slot with a mask, while at most capacity values are ever in flight
+// The header, the sequence numbers and the values are one cache-aligned
+// allocation; the first line of the header is only written by buffer_create,
+// and head and tail live on separate cache lines so that consumers and
+// producers do not invalidate each other's line; the cached_* copies are only
+// used by the single-producer/single-consumer functions and reserved only by
+// the multi-producer/single-consumer functions below
+// stamps holds the time each slot was filled while sojourn times are recorded
+// latest is only used by the conflating functions below
+// A typed buffer (see buffer_create_typed) keeps its values in values instead of data, each
+// slot stride bytes apart so that every slot starts on its own cache line
 typedef struct {
-    size_t size;
-    size_t next;
     size_t capacity;
+    size_t slots;
+    size_t mask;
     void** data;
+    char* values;
+    size_t elem_size;
+    size_t stride;
+    atomic_size_t* seq;
+    uint64_t* stamps;
+    histogram_t* sojourn;
+
+    // Consumer side
+    _Alignas(BUFFER_CACHE_LINE) atomic_size_t head;
+    size_t cached_tail;
+
+    // Producer side
+    _Alignas(BUFFER_CACHE_LINE) atomic_size_t tail;
+    size_t cached_head;
+    atomic_size_t reserved;
+
+    // Value of a conflating buffer, or the address of latest itself while it is empty
+    _Atomic(void*) latest;
 } buffer_t;
 
 enum buffer_status {
@@ -18,16 +92,237 @@ enum buffer_status {
 // Creates a buffer with the given capacity
 buffer_t* buffer_create(size_t capacity);
 
+// Creates a buffer with the given capacity whose slots hold copies of values of elem_size bytes
+// instead of pointers; only buffer_add_value/buffer_remove_value (and the functions below that
+// do not touch values, such as buffer_current_size) may be used on it
+// Returns NULL for a 0 elem_size
+buffer_t* buffer_create_typed(size_t capacity, size_t elem_size);
+
 // Adds the value into the buffer
+// Safe to call concurrently with any other buffer_add/buffer_remove
 // Returns BUFFER_SUCCESS if the buffer is not full and value was added
 // Returns BUFFER_ERROR otherwise
 enum buffer_status buffer_add(buffer_t* buffer, void* data);
 
 // Removes the value from the buffer in FIFO order and stores it in data
+// Safe to call concurrently with any other buffer_add/buffer_remove
 // Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
 // Returns BUFFER_ERROR otherwise
 enum buffer_status buffer_remove(buffer_t* buffer, void** data);
 
+// Adds the value into the buffer when it is only ever written by one thread
+// and read by one thread (see buffer_spsc_remove)
+// Only acquire/release ordering is used and the consumer's head is re-read only
+// when the cached copy says the buffer is full
+// Returns BUFFER_SUCCESS if the buffer is not full and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_spsc_add(buffer_t* buffer, void* data);
+
+// Removes the value from the buffer in FIFO order when it is only ever written by
+// one thread and read by one thread (see buffer_spsc_add)
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_spsc_remove(buffer_t* buffer, void** data);
+
+// Adds the value into the buffer when any number of threads write it but only
+// one thread reads it (see buffer_mpsc_remove)
+// A producer reserves room with a compare-and-swap that only succeeds while fewer
+// than capacity values are reserved, so a failed add leaves the reservation count
+// untouched, and claims its position with a fetch-and-add
+// Once it has a position it waits for at most one buffer_mpsc_remove that the
+// consumer is partway through to hand the slot back; it never waits for other producers
+// This is lock-free, not wait-free: the compare-and-swap retries whenever another
+// producer or the consumer changed the count first, and a producer stalled between
+// claiming its position and publishing the value holds the consumer up at that position
+// until it resumes, while the other producers go on adding until the buffer is full
+// Returns BUFFER_SUCCESS if the buffer is not full and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_mpsc_add(buffer_t* buffer, void* data);
+
+// Removes the value from the buffer in FIFO order when any number of threads
+// write it but only one thread reads it (see buffer_mpsc_add)
+// A position whose producer has not finished writing reads as empty
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_mpsc_remove(buffer_t* buffer, void** data);
+
+// Copies the elem_size bytes at value into a typed buffer
+// Claims positions like buffer_add, so it is safe to call concurrently with any other
+// buffer_add_value/buffer_remove_value
+// Returns BUFFER_SUCCESS if the buffer is not full and the value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_add_value(buffer_t* buffer, const void* value);
+
+// Removes the oldest value from a typed buffer and copies its elem_size bytes to value
+// Returns BUFFER_SUCCESS if the buffer is not empty and a value was removed
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_remove_value(buffer_t* buffer, void* value);
+
+// Inline core of buffer_add/buffer_remove and their typed versions
+// capacity and slots must be those of the buffer; callers that know them at compile time (see
+// channel_typed.h) pass constants so that the mask and the capacity check fold away, the
+// functions above pass the fields of the buffer
+// A position is claimed with one compare-and-swap on tail (head) once its sequence number says
+// the slot is free (full); the caller then writes (reads) the slot and hands it on with a release
+// store of pos + 1 (pos + slots) into the sequence number
+// Sojourn times are stamped by the callers in buffer.c, the inline users only run on buffers
+// that do not record them
+
+// Claims the position at tail for a producer and stores it in claimed
+// Returns BUFFER_ERROR if the buffer is full
+BUFFER_INLINE enum buffer_status buffer_claim_tail_fixed(buffer_t* buffer, size_t capacity, size_t slots, size_t* claimed)
+{
+    if (capacity == 0) {
+        return BUFFER_ERROR;
+    }
+    size_t pos = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    while (1) {
+        atomic_size_t* seq = &buffer->seq[pos & (slots - 1)];
+        ptrdiff_t diff = (ptrdiff_t)(atomic_load_explicit(seq, memory_order_acquire) - pos);
+        if (diff == 0) {
+            // With spare slots the sequence alone cannot tell that capacity is reached
+            if (slots != capacity &&
+                pos - atomic_load_explicit(&buffer->head, memory_order_acquire) >= capacity) {
+                return BUFFER_ERROR;
+            }
+            // The slot is free, try to claim the position (a failed CAS reloads pos)
+            if (atomic_compare_exchange_weak_explicit(&buffer->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *claimed = pos;
+                return BUFFER_SUCCESS;
+            }
+        } else if (diff < 0) {
+            // The slot still holds the value from the previous lap, so the buffer is full
+            return BUFFER_ERROR;
+        } else {
+            // Another producer claimed the position first
+            pos = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        }
+    }
+}
+
+// Claims the position at head for a consumer and stores it in claimed
+// Returns BUFFER_ERROR if the buffer is empty
+BUFFER_INLINE enum buffer_status buffer_claim_head_fixed(buffer_t* buffer, size_t capacity, size_t slots, size_t* claimed)
+{
+    if (capacity == 0) {
+        return BUFFER_ERROR;
+    }
+    size_t pos = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    while (1) {
+        atomic_size_t* seq = &buffer->seq[pos & (slots - 1)];
+        ptrdiff_t diff = (ptrdiff_t)(atomic_load_explicit(seq, memory_order_acquire) - (pos + 1));
+        if (diff == 0) {
+            // The slot holds a value, try to claim the position (a failed CAS reloads pos)
+            if (atomic_compare_exchange_weak_explicit(&buffer->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *claimed = pos;
+                return BUFFER_SUCCESS;
+            }
+        } else if (diff < 0) {
+            // Nothing has been written for this position yet, so the buffer is empty
+            return BUFFER_ERROR;
+        } else {
+            // Another consumer claimed the position first
+            pos = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+        }
+    }
+}
+
+// Same as buffer_add_value (buffer_remove_value) on a typed buffer of the given capacity and
+// elem_size that does not record sojourn times
+BUFFER_INLINE enum buffer_status buffer_add_value_fixed(buffer_t* buffer, const void* value, size_t capacity,
+                                                        size_t elem_size)
+{
+    size_t slots = BUFFER_SLOTS(capacity);
+    size_t pos;
+    if (buffer_claim_tail_fixed(buffer, capacity, slots, &pos) != BUFFER_SUCCESS) {
+        return BUFFER_ERROR;
+    }
+    memcpy(buffer->values + (pos & (slots - 1)) * BUFFER_STRIDE(elem_size), value, elem_size);
+    atomic_store_explicit(&buffer->seq[pos & (slots - 1)], pos + 1, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+BUFFER_INLINE enum buffer_status buffer_remove_value_fixed(buffer_t* buffer, void* value, size_t capacity,
+                                                           size_t elem_size)
+{
+    size_t slots = BUFFER_SLOTS(capacity);
+    size_t pos;
+    if (buffer_claim_head_fixed(buffer, capacity, slots, &pos) != BUFFER_SUCCESS) {
+        return BUFFER_ERROR;
+    }
+    memcpy(value, buffer->values + (pos & (slots - 1)) * BUFFER_STRIDE(elem_size), elem_size);
+    atomic_store_explicit(&buffer->seq[pos & (slots - 1)], pos + slots, memory_order_release);
+    return BUFFER_SUCCESS;
+}
+
+// Adds the value into the buffer, removing the oldest values to make room while it is full
+// Safe to call concurrently with buffer_add/buffer_remove: a value is dropped by claiming its
+// position like buffer_remove does, so it is never also removed by a consumer, and a consumer
+// never sees a slot that is being overwritten
+// Returns the number of values dropped
+size_t buffer_overwrite_add(buffer_t* buffer, void* data);
+
+// Bulk versions of the functions above
+// They move up to count values between the buffer and the data array in FIFO order,
+// claiming all of their positions at once and copying the values in at most two
+// contiguous segments (before and after the end of the ring)
+// Each has the same thread-safety requirements as its single-value counterpart
+// Returns the number of values moved, which is 0 if the buffer is full (add) or empty (remove)
+size_t buffer_add_many(buffer_t* buffer, void** data, size_t count);
+size_t buffer_remove_many(buffer_t* buffer, void** data, size_t count);
+size_t buffer_spsc_add_many(buffer_t* buffer, void** data, size_t count);
+size_t buffer_spsc_remove_many(buffer_t* buffer, void** data, size_t count);
+size_t buffer_mpsc_add_many(buffer_t* buffer, void** data, size_t count);
+size_t buffer_mpsc_remove_many(buffer_t* buffer, void** data, size_t count);
+
+// Broadcast use of the ring: every value added is read by any number of cursors, each of
+// which walks the positions on its own (see buffer_broadcast_read)
+// head is not moved by reads; the caller keeps it at (or below) the lowest cursor with
+// buffer_broadcast_release, and a value is only overwritten once head has passed it, so
+// at most capacity values are ahead of the slowest cursor
+// The seq numbers are not used, tail is published with release ordering after each value
+
+// Adds the value to a broadcast buffer; producers must be serialized by the caller
+// Returns BUFFER_SUCCESS if fewer than capacity values are ahead of head and value was added
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_broadcast_add(buffer_t* buffer, void* data);
+
+// Reads the value at *cursor of a broadcast buffer and moves the cursor past it
+// Only one thread at a time may read with the same cursor
+// Returns BUFFER_SUCCESS if a value was read
+// Returns BUFFER_ERROR if the cursor has caught up with tail
+enum buffer_status buffer_broadcast_read(buffer_t* buffer, atomic_size_t* cursor, void** data);
+
+// Returns the position the next value of a broadcast buffer is added at, the start for a new cursor
+size_t buffer_broadcast_tail(buffer_t* buffer);
+
+// Returns the position before which the values of a broadcast buffer may be overwritten
+size_t buffer_broadcast_head(buffer_t* buffer);
+
+// Lets the values of a broadcast buffer before position head be overwritten
+// head must not be above any cursor still reading and must not move backwards
+void buffer_broadcast_release(buffer_t* buffer, size_t head);
+
+// Conflating use of the buffer: it holds at most one value, the latest one added
+// Adding never fails, it replaces a value that was not removed yet; any pointer, NULL included,
+// can be added, and both functions are safe to call concurrently with any other of them
+
+// Makes data the value of a conflating buffer
+// Returns true if it replaced a value that was never removed
+bool buffer_conflate_add(buffer_t* buffer, void* data);
+
+// Removes the value of a conflating buffer and stores it in data
+// Returns BUFFER_SUCCESS if the buffer held a value
+// Returns BUFFER_ERROR otherwise
+enum buffer_status buffer_conflate_remove(buffer_t* buffer, void** data);
+
+// Starts recording the time between adding and removing each value into histogram
+// Must be called before the buffer is used; the histogram is not freed with the buffer
+// Returns BUFFER_SUCCESS, or BUFFER_ERROR if the time stamps could not be allocated
+enum buffer_status buffer_record_sojourn(buffer_t* buffer, histogram_t* histogram);
+
 // Frees the memory allocated to the buffer
 void buffer_free(buffer_t* buffer);
 
@@ -35,6 +330,7 @@ void buffer_free(buffer_t* buffer);
 size_t buffer_capacity(buffer_t* buffer);
 
 // Returns the current number of elements in the buffer
+// While other threads are adding or removing this is only a snapshot
 size_t buffer_current_size(buffer_t* buffer);
 
 // Peeks at a value in the buffer
@@ -1,23 +1,1127 @@
 #include "channel.h"
+#include "channel_registry.h"
+#include "channel_probes.h"
+#include "channel_trace.h"
+#include "channel_typed.h"
+#include "futex.h"
+#include <sched.h>
+#include <unistd.h>
 
-// Creates a new channel with the provided size and returns it to the caller
-// A 0 size indicates an unbuffered channel, whereas a positive size indicates a buffered channel
-channel_t* channel_create(size_t size)
+// Spin budgets (buffer checks before yielding) for the hybrid and adaptive wait policies
+#define CHANNEL_SPIN_MIN 16
+#define CHANNEL_SPIN_DEFAULT 128
+#define CHANNEL_SPIN_MAX 2048
+// Number of sched_yield calls between spinning and parking
+#define CHANNEL_YIELD_LIMIT 4
+// Number of selects a send, receive or close collects under MutexLock at a time; they are woken
+// after releasing it, and the lock is taken again for the next batch
+#define CHANNEL_NOTIFY_BATCH 8
+
+// Returns the CLOCK_MONOTONIC time in nanoseconds
+static inline uint64_t channel_stat_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+#ifdef CHANNEL_STATS
+// Number of counter shards per channel (log2)
+#define CHANNEL_STATS_SHARD_BITS 4
+#define CHANNEL_STATS_SHARDS (1 << CHANNEL_STATS_SHARD_BITS)
+
+// One shard of the counters of a channel, on its own cache line
+// Threads hash onto shards, so an update is an uncontended relaxed add in the common case
+struct channel_stats_shard {
+    _Alignas(BUFFER_CACHE_LINE) atomic_uint_fast64_t sends;
+    atomic_uint_fast64_t receives;
+    atomic_uint_fast64_t send_full;
+    atomic_uint_fast64_t receive_empty;
+    atomic_uint_fast64_t send_parks;
+    atomic_uint_fast64_t receive_parks;
+    atomic_uint_fast64_t parked_ns;
+    atomic_uint_fast64_t wakeups;
+    atomic_uint_fast64_t wakeups_with_work;
+    atomic_size_t peak_size;
+    atomic_uint_fast64_t lock_acquisitions[CHANNEL_SITES];
+    atomic_uint_fast64_t lock_contended[CHANNEL_SITES];
+    atomic_uint_fast64_t lock_wait_ns[CHANNEL_SITES];
+    atomic_uint_fast64_t lock_hold_ns[CHANNEL_SITES];
+};
+
+// Returns the shard of the calling thread
+static inline struct channel_stats_shard* channel_stats_shard(channel_t* channel)
+{
+    uint64_t id = (uint64_t)(uintptr_t)pthread_self();
+    return &channel->stats[(id * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - CHANNEL_STATS_SHARD_BITS)];
+}
+
+// Adds n to a counter of the calling thread's shard
+#define CHANNEL_STAT_ADD(channel, counter, n) \
+    atomic_fetch_add_explicit(&channel_stats_shard(channel)->counter, (n), memory_order_relaxed)
+
+// Records the number of values in the buffer if it is the highest the calling thread's shard has seen
+static inline void channel_stat_size(channel_t* channel)
+{
+    struct channel_stats_shard* shard = channel_stats_shard(channel);
+    size_t size = buffer_current_size(channel->buffer);
+    if(size > atomic_load_explicit(&shard->peak_size, memory_order_relaxed)){
+        atomic_store_explicit(&shard->peak_size, size, memory_order_relaxed);
+    }
+}
+
+// Acquires the MutexLock of the channel for the given call site
+// The lock is tried first so that only acquisitions that found it taken pay for timing the wait
+static inline void channel_lock(channel_t* channel, enum channel_lock_site site)
+{
+    CHANNEL_STAT_ADD(channel, lock_acquisitions[site], 1);
+    if(pthread_mutex_trylock(&channel->MutexLock) != 0){
+        uint64_t start = channel_stat_now();
+        pthread_mutex_lock(&channel->MutexLock);
+        CHANNEL_STAT_ADD(channel, lock_contended[site], 1);
+        CHANNEL_STAT_ADD(channel, lock_wait_ns[site], channel_stat_now() - start);
+    }
+    channel->lock_acquired_ns = channel_stat_now();
+}
+
+// Releases the MutexLock of the channel taken by channel_lock for the given call site
+static inline void channel_unlock(channel_t* channel, enum channel_lock_site site)
+{
+    uint64_t held = channel_stat_now() - channel->lock_acquired_ns;
+    pthread_mutex_unlock(&channel->MutexLock);
+    CHANNEL_STAT_ADD(channel, lock_hold_ns[site], held);
+}
+#else
+#define CHANNEL_STAT_ADD(channel, counter, n) ((void)0)
+#define channel_stat_size(channel) ((void)0)
+#define channel_lock(channel, site) pthread_mutex_lock(&(channel)->MutexLock)
+#define channel_unlock(channel, site) pthread_mutex_unlock(&(channel)->MutexLock)
+#endif
+
+// Records an event in the trace of the calling thread (see channel_trace.h) when built with CHANNEL_TRACE
+// A NULL channel records the event without a channel
+#ifdef CHANNEL_TRACE
+#define CHANNEL_TRACE_EVENT(channel, op, outcome) channel_trace_record(channel_trace_id(channel), (op), (int)(outcome))
+#else
+#define CHANNEL_TRACE_EVENT(channel, op, outcome) ((void)0)
+#endif
+
+// Returns the id a channel is traced under, 0 for none
+static inline uint32_t channel_trace_id(channel_t* channel)
+{
+    return channel ? channel->id : 0;
+}
+
+// Returns the buffer occupancy passed to probes, 0 for no channel
+static inline size_t channel_probe_size(channel_t* channel)
 {
+    return channel ? buffer_current_size(channel->buffer) : 0;
+}
+
+// A blocked channel_select parks on its own waiter instead of the futex words of a channel
+// so that an event on one of its channels wakes exactly that select
+// done is set once the result of the select is decided, either by the select itself or by
+// a thread that completed a rendezvous with it on an unbuffered channel (which also sets selected)
+// holds counts the threads about to notify the waiter after releasing MutexLock (see
+// channel_collect_selectors); the waiter is not destroyed before they are done with it
+// idle is set while no select runs on the waiter (a select set between selects): its
+// registrations stay linked, but notifications and rendezvous skip them without taking any lock
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool notified;
+    bool done;
+    size_t selected;
+    atomic_uint holds;
+    atomic_bool idle;
+} select_waiter_t;
+
+// One entry of a blocked channel_select (or of a select set), stored in the selectors list of its channel
+// On an unbuffered channel the entry doubles as the per-waiter slot of the rendezvous:
+// a receiver takes entry->data from a waiting sender and a sender stores into entry->data
+// of a waiting receiver
+// A rendezvous only completes enabled entries; enabled is only changed while the waiter is done
+// pending is set by a send or receive that handed the registration an event (see
+// channel_collect_selectors); the select takes it into handed when it wakes up, and passes
+// events it did not use on to the channel when it is done (see select_registration_pass_on)
+typedef struct {
+    select_waiter_t* waiter;
+    select_t* entry;
+    size_t index;
+    bool enabled;
+    atomic_bool pending;
+    bool handed;
+} select_registration_t;
+
+// A select set keeps one waiter registered on the channels of its entries between selects
+// Entries are allocated one by one so that the registrations in the channels' lists never
+// move; entries[id] is NULL once the entry with that id was removed
+// The waiter is done and idle whenever the set is not selecting, so no rendezvous can complete
+// it and no send or receive spends time on it
+typedef struct select_set_entry {
+    select_t op;
+    select_registration_t registration;
+} select_set_entry_t;
+
+struct select_set {
+    select_waiter_t waiter;
+    select_set_entry_t** entries;
+    size_t capacity;
+};
+
+// State shared by a broadcast channel and its subscriptions, which all use one buffer: a value
+// is added to it once and every subscription reads it at its own cursor
+// publish_lock serializes the senders; nothing else is ever taken while holding it
+// subscribers_lock protects the list of open subscriptions and moving the head of the buffer up
+// to their lowest cursor; it is taken before the MutexLock of a subscription
+// subscriber_count is changed while holding both locks, so a send that finds no subscription
+// can drop its value without a new subscription seeing it
+// references counts the broadcast channel and its subscriptions that are not destroyed yet,
+// the last one destroyed frees the buffer and this state
+typedef struct channel_broadcast {
+    channel_t* channel;
+    buffer_t* buffer;
+    pthread_mutex_t publish_lock;
+    pthread_mutex_t subscribers_lock;
+    list_t* subscribers;
+    size_t subscriber_count;
+    atomic_size_t references;
+} channel_broadcast_t;
+
+// Sets attr to the defaults used by channel_create
+void channel_attr_init(channel_attr_t* attr)
+{
+    attr->kind = CHANNEL_MPMC;
+    attr->wait_policy = CHANNEL_WAIT_BLOCK;
+    attr->name = NULL;
+    attr->record_latency = false;
+    attr->elem_size = 0;
+}
+
+// Creates a channel with the given buffer and options
+// broadcast is the state of a broadcast channel or subscription, NULL for other kinds
+// Returns NULL for a NULL buffer or if an allocation fails; the buffer stays the caller's then
+static channel_t* channel_create_buffer(buffer_t* buffer, const channel_attr_t* attr, channel_broadcast_t* broadcast)
+{
+    // Time stamp every slot if the sojourn times are wanted
+    // Broadcast and conflating channels do not keep their values in the ring, so they have none
+    bool timed = attr->record_latency && !broadcast && attr->kind != CHANNEL_CONFLATING;
+
+    // Allocate everything that can fail first so that a failure only has to free it again
     channel_t* channel = (channel_t*)malloc(sizeof(channel_t));
-	channel->buffer = buffer_create(size);
+    list_t* selectors = list_create();
+    histogram_t* latency = timed ? histogram_create() : NULL;
+    bool failed = !buffer || !channel || !selectors || (timed && !latency);
+#ifdef CHANNEL_STATS
+    struct channel_stats_shard* stats = (struct channel_stats_shard*)aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct channel_stats_shard) * CHANNEL_STATS_SHARDS);
+    failed = failed || !stats;
+#endif
+    if(!failed && timed && buffer_record_sojourn(buffer, latency) != BUFFER_SUCCESS){
+        failed = true;
+    }
+    if(failed){
+#ifdef CHANNEL_STATS
+        free(stats);
+#endif
+        histogram_free(latency);
+        if(selectors){
+            list_destroy(selectors);
+        }
+        free(channel);
+        return NULL;
+    }
+
+	channel->buffer = buffer;
+    channel->kind = attr->kind;
+    channel->broadcast = broadcast;
+    atomic_init(&channel->cursor, 0);
+    atomic_init(&channel->dropped, 0);
+
+    // Spinning only helps if the thread we wait for can run on another cpu
+    channel->wait_policy = attr->wait_policy;
+    channel->spin_max = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? CHANNEL_SPIN_MAX : 0;
+    atomic_init(&channel->spin_budget, CHANNEL_SPIN_DEFAULT < channel->spin_max ? CHANNEL_SPIN_DEFAULT : channel->spin_max);
 
     // Set the channel to be open
-	channel->closed = 1;
+	atomic_init(&channel->closed, 1);
+    atomic_init(&channel->send_futex, 0);
+    atomic_init(&channel->recv_futex, 0);
+    atomic_init(&channel->send_waiters, 0);
+    atomic_init(&channel->recv_waiters, 0);
+    channel->selectors = selectors;
+    atomic_init(&channel->send_selects, 0);
+    atomic_init(&channel->recv_selects, 0);
 
-    // Initialize the conditional variables aswell as the mutex so we can lock/unlock
+    // Initialize the mutex so we can lock/unlock
 	pthread_mutex_init(&channel->MutexLock, NULL);
-    pthread_cond_init(&channel->read, NULL);
-    pthread_cond_init(&channel->write, NULL);
+
+#ifdef CHANNEL_STATS
+    channel->stats = stats;
+    memset(channel->stats, 0, sizeof(struct channel_stats_shard) * CHANNEL_STATS_SHARDS);
+#endif
+    channel->latency = latency;
+
+    // Make the channel visible to registry snapshots
+    channel->name = NULL;
+    channel_registry_add(channel);
+    if(attr->name){
+        channel_set_name(channel, attr->name);
+    }
 
 	return channel;
 }
 
+// Creates a channel that owns buffer, and frees the buffer if the channel cannot be created
+static channel_t* channel_create_owner(buffer_t* buffer, const channel_attr_t* attr)
+{
+    channel_t* channel = channel_create_buffer(buffer, attr, NULL);
+    if(!channel && buffer){
+        buffer_free(buffer);
+    }
+    return channel;
+}
+
+// Creates a new channel with the provided size and options and returns it to the caller
+// Returns NULL for invalid options or if an allocation fails
+channel_t* channel_create_attr(size_t size, const channel_attr_t* attr)
+{
+    channel_attr_t defaults;
+    if(!attr){
+        channel_attr_init(&defaults);
+        attr = &defaults;
+    }
+    if(attr->kind == CHANNEL_SUBSCRIPTION){
+        return NULL;
+    }
+    if(attr->kind == CHANNEL_CONFLATING){
+        // The one slot is only there to keep the channel buffered, the value lives in latest
+        return channel_create_owner(buffer_create(1), attr);
+    }
+    if(attr->kind == CHANNEL_LOSSY && size == 0){
+        // There is no oldest value to drop without a buffer
+        return NULL;
+    }
+    if(attr->kind == CHANNEL_TYPED){
+        // Values are copied through the slots, an unbuffered rendezvous would have none
+        return size > 0 ? channel_create_owner(buffer_create_typed(size, attr->elem_size), attr) : NULL;
+    }
+    if(attr->kind != CHANNEL_BROADCAST){
+        return channel_create_owner(buffer_create(size), attr);
+    }
+
+    // A broadcast channel needs room for at least one value its subscriptions have not read
+    if(size == 0){
+        return NULL;
+    }
+    channel_broadcast_t* broadcast = (channel_broadcast_t*)malloc(sizeof(channel_broadcast_t));
+    if(!broadcast){
+        return NULL;
+    }
+    broadcast->buffer = buffer_create(size);
+    pthread_mutex_init(&broadcast->publish_lock, NULL);
+    pthread_mutex_init(&broadcast->subscribers_lock, NULL);
+    broadcast->subscribers = list_create();
+    broadcast->subscriber_count = 0;
+    atomic_init(&broadcast->references, 1);
+    broadcast->channel = broadcast->subscribers ? channel_create_buffer(broadcast->buffer, attr, broadcast) : NULL;
+    if(!broadcast->channel){
+        pthread_mutex_destroy(&broadcast->publish_lock);
+        pthread_mutex_destroy(&broadcast->subscribers_lock);
+        if(broadcast->subscribers){
+            list_destroy(broadcast->subscribers);
+        }
+        if(broadcast->buffer){
+            buffer_free(broadcast->buffer);
+        }
+        free(broadcast);
+        return NULL;
+    }
+    return broadcast->channel;
+}
+
+// Allocates a channel of the given kind with the default options
+static channel_t* channel_create_kind(size_t size, enum channel_kind kind)
+{
+    channel_attr_t attr;
+    channel_attr_init(&attr);
+    attr.kind = kind;
+    return channel_create_attr(size, &attr);
+}
+
+// Creates a new channel with the provided size and returns it to the caller
+// A 0 size indicates an unbuffered channel, whereas a positive size indicates a buffered channel
+channel_t* channel_create(size_t size)
+{
+    return channel_create_kind(size, CHANNEL_MPMC);
+}
+
+// Creates a new single-producer/single-consumer channel with the provided size and returns it to the caller
+channel_t* channel_create_spsc(size_t size)
+{
+    return channel_create_kind(size, CHANNEL_SPSC);
+}
+
+// Creates a new multi-producer/single-consumer channel with the provided size and returns it to the caller
+channel_t* channel_create_mpsc(size_t size)
+{
+    return channel_create_kind(size, CHANNEL_MPSC);
+}
+
+// Creates a new broadcast channel with the provided size and returns it to the caller
+// Returns NULL for a 0 size
+channel_t* channel_create_broadcast(size_t size)
+{
+    return channel_create_kind(size, CHANNEL_BROADCAST);
+}
+
+// Creates a new conflating channel and returns it to the caller
+channel_t* channel_create_conflating(void)
+{
+    return channel_create_kind(1, CHANNEL_CONFLATING);
+}
+
+// Makes the last of count values the value of a conflating channel, counting the ones replaced
+// Returns count, a conflating channel never fills up
+static size_t channel_conflate_add_many(channel_t* channel, void** data, size_t count)
+{
+    uint64_t replaced = 0;
+    for(size_t i = 0; i < count; i++){
+        replaced += buffer_conflate_add(channel->buffer, data[i]);
+    }
+    if(replaced > 0){
+        atomic_fetch_add_explicit(&channel->dropped, replaced, memory_order_relaxed);
+    }
+    return count;
+}
+
+// Creates a new lossy channel with the provided size and returns it to the caller
+// Returns NULL for a 0 size
+channel_t* channel_create_lossy(size_t size)
+{
+    return channel_create_kind(size, CHANNEL_LOSSY);
+}
+
+// Creates a new typed channel for values of elem_size bytes and returns it to the caller
+// Returns NULL for a 0 capacity or elem_size
+channel_t* channel_create_typed(size_t capacity, size_t elem_size)
+{
+    channel_attr_t attr;
+    channel_attr_init(&attr);
+    attr.kind = CHANNEL_TYPED;
+    attr.elem_size = elem_size;
+    return channel_create_attr(capacity, &attr);
+}
+
+// Adds count values to a lossy channel, dropping the oldest ones while the buffer is full
+// Returns count, a lossy channel never fills up
+static size_t channel_overwrite_add_many(channel_t* channel, void** data, size_t count)
+{
+    size_t dropped = 0;
+    for(size_t i = 0; i < count; i++){
+        dropped += buffer_overwrite_add(channel->buffer, data[i]);
+    }
+    if(dropped > 0){
+        atomic_fetch_add_explicit(&channel->dropped, dropped, memory_order_relaxed);
+    }
+    return count;
+}
+
+// Adds up to count values to the buffer of a broadcast channel for all of its subscriptions
+// Values sent while there is no subscription reach no one and count as added
+// Returns the number of values added
+static size_t channel_broadcast_add_many(channel_t* channel, void** data, size_t count)
+{
+    channel_broadcast_t* broadcast = channel->broadcast;
+    size_t done = 0;
+    pthread_mutex_lock(&broadcast->publish_lock);
+    if(broadcast->subscriber_count == 0){
+        done = count;
+    } else {
+        while(done < count && buffer_broadcast_add(channel->buffer, data[done]) == BUFFER_SUCCESS){
+            done++;
+        }
+    }
+    pthread_mutex_unlock(&broadcast->publish_lock);
+    return done;
+}
+
+// Reads up to count values of a subscription at its cursor
+// Returns the number of values read
+static size_t channel_subscription_read_many(channel_t* channel, void** data, size_t count)
+{
+    size_t done = 0;
+    while(done < count && buffer_broadcast_read(channel->buffer, &channel->cursor, &data[done]) == BUFFER_SUCCESS){
+        done++;
+    }
+    return done;
+}
+
+// Adds data to the channel's buffer without blocking
+// On a typed channel data is the address of the value to copy in, and on removal the address
+// the value is copied to is passed in place of data
+static inline enum buffer_status channel_buffer_add(channel_t* channel, void* data)
+{
+    switch (channel->kind) {
+    case CHANNEL_SPSC:
+        return buffer_spsc_add(channel->buffer, data);
+    case CHANNEL_MPSC:
+        return buffer_mpsc_add(channel->buffer, data);
+    case CHANNEL_BROADCAST:
+        return channel_broadcast_add_many(channel, &data, 1) == 1 ? BUFFER_SUCCESS : BUFFER_ERROR;
+    case CHANNEL_SUBSCRIPTION:
+        return BUFFER_ERROR;
+    case CHANNEL_CONFLATING:
+        channel_conflate_add_many(channel, &data, 1);
+        return BUFFER_SUCCESS;
+    case CHANNEL_LOSSY:
+        channel_overwrite_add_many(channel, &data, 1);
+        return BUFFER_SUCCESS;
+    case CHANNEL_TYPED:
+        return buffer_add_value(channel->buffer, data);
+    default:
+        return buffer_add(channel->buffer, data);
+    }
+}
+
+// Removes data from the channel's buffer without blocking
+static inline enum buffer_status channel_buffer_remove(channel_t* channel, void** data)
+{
+    switch (channel->kind) {
+    case CHANNEL_SPSC:
+        return buffer_spsc_remove(channel->buffer, data);
+    case CHANNEL_MPSC:
+        return buffer_mpsc_remove(channel->buffer, data);
+    case CHANNEL_BROADCAST:
+        return BUFFER_ERROR;
+    case CHANNEL_SUBSCRIPTION:
+        return buffer_broadcast_read(channel->buffer, &channel->cursor, data);
+    case CHANNEL_CONFLATING:
+        return buffer_conflate_remove(channel->buffer, data);
+    case CHANNEL_TYPED:
+        return buffer_remove_value(channel->buffer, (void*)data);
+    default:
+        return buffer_remove(channel->buffer, data);
+    }
+}
+
+// Adds up to count values to the channel's buffer without blocking
+// Returns the number of values added
+static inline size_t channel_buffer_add_many(channel_t* channel, void** data, size_t count)
+{
+    switch (channel->kind) {
+    case CHANNEL_SPSC:
+        return buffer_spsc_add_many(channel->buffer, data, count);
+    case CHANNEL_MPSC:
+        return buffer_mpsc_add_many(channel->buffer, data, count);
+    case CHANNEL_BROADCAST:
+        return channel_broadcast_add_many(channel, data, count);
+    case CHANNEL_SUBSCRIPTION:
+        return 0;
+    case CHANNEL_CONFLATING:
+        return channel_conflate_add_many(channel, data, count);
+    case CHANNEL_LOSSY:
+        return channel_overwrite_add_many(channel, data, count);
+    case CHANNEL_TYPED:
+        // The bulk functions take arrays of pointers, which a typed channel does not hold
+        return 0;
+    default:
+        return buffer_add_many(channel->buffer, data, count);
+    }
+}
+
+// Removes up to count values from the channel's buffer without blocking
+// Returns the number of values removed
+static inline size_t channel_buffer_remove_many(channel_t* channel, void** data, size_t count)
+{
+    switch (channel->kind) {
+    case CHANNEL_SPSC:
+        return buffer_spsc_remove_many(channel->buffer, data, count);
+    case CHANNEL_MPSC:
+        return buffer_mpsc_remove_many(channel->buffer, data, count);
+    case CHANNEL_BROADCAST:
+        return 0;
+    case CHANNEL_SUBSCRIPTION:
+        return channel_subscription_read_many(channel, data, count);
+    case CHANNEL_CONFLATING:
+        // There is never more than the latest value to take
+        return count > 0 && buffer_conflate_remove(channel->buffer, data) == BUFFER_SUCCESS ? 1 : 0;
+    case CHANNEL_TYPED:
+        return 0;
+    default:
+        return buffer_remove_many(channel->buffer, data, count);
+    }
+}
+
+// Returns true once channel_close has been called on the channel
+static inline bool channel_is_closed(channel_t* channel)
+{
+    return atomic_load_explicit(&channel->closed, memory_order_acquire) == 0;
+}
+
+// Returns true if the channel has no buffer and every send must meet a receive
+static inline bool channel_is_unbuffered(channel_t* channel)
+{
+    return buffer_capacity(channel->buffer) == 0;
+}
+
+// Returns false for the direction a channel does not have: a broadcast channel is only sent on
+// and a subscription is only received from
+static inline bool channel_allows(channel_t* channel, enum direction dir)
+{
+    return channel->kind != (dir == SEND ? CHANNEL_SUBSCRIPTION : CHANNEL_BROADCAST);
+}
+
+// Returns true if the channel copies values of a fixed size instead of passing pointers
+static inline bool channel_is_typed(channel_t* channel)
+{
+    return channel->kind == CHANNEL_TYPED;
+}
+
+// Wakes the select that owns the waiter
+static void select_waiter_notify(select_waiter_t* waiter)
+{
+    pthread_mutex_lock(&waiter->lock);
+    waiter->notified = true;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->lock);
+}
+
+// Hands an event to up to max selects registered on the channel for the given direction and
+// collects their waiters into waiters, holding each of them
+// Registrations still pending from an earlier event are skipped, so successive events go to
+// the registered selects in turn
+// Must be called with MutexLock held; the caller wakes and releases the collected waiters with
+// select_waiters_notify once it released the lock
+// Returns the number of waiters collected
+static size_t channel_collect_selectors(channel_t* channel, enum direction dir, select_waiter_t** waiters, size_t max)
+{
+    size_t collected = 0;
+    for (list_node_t* node = list_begin(channel->selectors); node != NULL && collected < max; node = list_next(node)) {
+        select_registration_t* registration = (select_registration_t*)list_data(node);
+        // enabled only changes while the waiter is idle, so it can be read once it is not
+        if (registration->entry->dir == dir && !atomic_load(&registration->waiter->idle) && registration->enabled &&
+            !atomic_load(&registration->pending)) {
+            CHANNEL_PROBE(select_notify, channel, dir);
+            atomic_store(&registration->pending, true);
+            atomic_fetch_add_explicit(&registration->waiter->holds, 1, memory_order_relaxed);
+            waiters[collected++] = registration->waiter;
+        }
+    }
+    return collected;
+}
+
+// Wakes the waiters collected by channel_collect_selectors and releases them
+// Must be called without MutexLock, after which a select may unregister and destroy its waiter
+// as soon as this thread no longer holds it
+static void select_waiters_notify(select_waiter_t** waiters, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        select_waiter_notify(waiters[i]);
+        atomic_fetch_sub_explicit(&waiters[i]->holds, 1, memory_order_release);
+    }
+}
+
+// Hands events to up to count selects registered on the channel for the given direction,
+// CHANNEL_NOTIFY_BATCH at a time, and wakes them outside MutexLock
+// Returns the number of selects woken
+static size_t channel_notify_selectors(channel_t* channel, enum direction dir, size_t count, enum channel_lock_site site)
+{
+    select_waiter_t* notify[CHANNEL_NOTIFY_BATCH];
+    size_t woken = 0;
+    size_t collected;
+    do {
+        size_t max = count - woken < CHANNEL_NOTIFY_BATCH ? count - woken : CHANNEL_NOTIFY_BATCH;
+        channel_lock(channel, site);
+        collected = channel_collect_selectors(channel, dir, notify, max);
+        channel_unlock(channel, site);
+        select_waiters_notify(notify, collected);
+        if (collected > 0) {
+            CHANNEL_STAT_ADD(channel, wakeups, (uint64_t)collected);
+        }
+        woken += collected;
+    } while (collected == CHANNEL_NOTIFY_BATCH && woken < count);
+    return woken;
+}
+
+// Wakes up to count threads parked on one side of the channel, then hands the events left
+// over to as many selects registered for that side
+// The waiter counts are read with a read-modify-write so that they are ordered against the
+// increment in channel_park/select_register: either the waiter sees the new value on its
+// retry or this thread sees the waiter counted
+// Bumping the futex word first makes a thread that is just about to sleep return at once
+// No more threads and selects are woken than there are values to take, so a single send or
+// receive never wakes a herd that would only find the buffer full (empty) again
+static void channel_wake_sleepers(channel_t* channel, enum direction dir, size_t count, enum channel_lock_site site)
+{
+    atomic_uint* word = dir == SEND ? &channel->send_futex : &channel->recv_futex;
+    atomic_size_t* waiters = dir == SEND ? &channel->send_waiters : &channel->recv_waiters;
+    atomic_size_t* selects = dir == SEND ? &channel->send_selects : &channel->recv_selects;
+    size_t sleeping = atomic_fetch_add(waiters, 0);
+    size_t left = count;
+    if (sleeping > 0) {
+        size_t wake = count < sleeping ? count : sleeping;
+        atomic_fetch_add(word, 1);
+        int woken = futex_wake(word, wake < FUTEX_WAKE_ALL ? (int)wake : FUTEX_WAKE_ALL);
+        if (woken > 0) {
+            CHANNEL_STAT_ADD(channel, wakeups, (uint64_t)woken);
+            CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_WAKE, woken);
+            left -= (size_t)woken < left ? (size_t)woken : left;
+        }
+    }
+    if (left > 0 && atomic_fetch_add(selects, 0) > 0) {
+        channel_notify_selectors(channel, dir, left, site);
+    }
+}
+
+static void channel_broadcast_wake(channel_broadcast_t* broadcast, size_t count, enum channel_lock_site site);
+static void channel_broadcast_release(channel_t* subscription, size_t count, enum channel_lock_site site);
+
+// Wakes up to count sleeping threads or selects of one side of the channel after count values
+// were added to (removed from) the buffer by the given call site (see channel_wake_sleepers)
+static void channel_wake(channel_t* channel, enum direction dir, size_t count, enum channel_lock_site site)
+{
+    // Values added wake receivers, values removed wake senders
+    if (dir == RECV) {
+        CHANNEL_STAT_ADD(channel, sends, count);
+        channel_stat_size(channel);
+    } else {
+        CHANNEL_STAT_ADD(channel, receives, count);
+    }
+    // Nobody waits on the missing side of a broadcast channel or subscription: values sent on a
+    // broadcast channel are received from its subscriptions, and values received from them
+    // make room for the senders of the broadcast channel
+    if (channel->kind == CHANNEL_BROADCAST && dir == RECV) {
+        channel_broadcast_wake(channel->broadcast, count, site);
+        return;
+    }
+    if (channel->kind == CHANNEL_SUBSCRIPTION && dir == SEND) {
+        channel_broadcast_release(channel, count, site);
+        return;
+    }
+    channel_wake_sleepers(channel, dir, count, site);
+}
+
+// Wakes up to count sleeping receivers and the selects waiting to receive after count values
+// were added to the buffer
+static inline void channel_wake_receivers(channel_t* channel, size_t count, enum channel_lock_site site)
+{
+    channel_wake(channel, RECV, count, site);
+}
+
+// Wakes up to count sleeping senders and the selects waiting to send after count values
+// were removed from the buffer
+static inline void channel_wake_senders(channel_t* channel, size_t count, enum channel_lock_site site)
+{
+    channel_wake(channel, SEND, count, site);
+}
+
+// Wakes one parked receiver and the selects waiting to receive after a value was added to the buffer
+static inline void channel_wake_receiver(channel_t* channel, enum channel_lock_site site)
+{
+    channel_wake_receivers(channel, 1, site);
+}
+
+// Wakes one parked sender and the selects waiting to send after a value was removed from the buffer
+static inline void channel_wake_sender(channel_t* channel, enum channel_lock_site site)
+{
+    channel_wake_senders(channel, 1, site);
+}
+
+// Wakes the receivers and the selects of every open subscription after count values were
+// sent on a broadcast channel
+static void channel_broadcast_wake(channel_broadcast_t* broadcast, size_t count, enum channel_lock_site site)
+{
+    pthread_mutex_lock(&broadcast->subscribers_lock);
+    for (list_node_t* node = list_begin(broadcast->subscribers); node != NULL; node = list_next(node)) {
+        channel_wake((channel_t*)list_data(node), RECV, count, site);
+    }
+    pthread_mutex_unlock(&broadcast->subscribers_lock);
+}
+
+// Returns the lowest cursor of the open subscriptions, which there must be some of
+// Must be called with subscribers_lock held
+static size_t channel_broadcast_lowest(channel_broadcast_t* broadcast)
+{
+    list_node_t* node = list_begin(broadcast->subscribers);
+    size_t lowest = atomic_load(&((channel_t*)list_data(node))->cursor);
+    for (node = list_next(node); node != NULL; node = list_next(node)) {
+        size_t cursor = atomic_load(&((channel_t*)list_data(node))->cursor);
+        if (cursor < lowest) {
+            lowest = cursor;
+        }
+    }
+    return lowest;
+}
+
+// Moves the head of the broadcast buffer up to the lowest cursor of the open subscriptions
+// The cursors are read again after every move until the lowest one stays put: a subscription
+// stores its cursor before it reads the head, so either it sees the head at its old cursor and
+// moves it itself, or the second read here sees its new cursor
+// Must be called with subscribers_lock held
+// Returns the number of values released for the senders
+static size_t channel_broadcast_advance(channel_broadcast_t* broadcast)
+{
+    if (list_count(broadcast->subscribers) == 0) {
+        return 0;
+    }
+    size_t start = buffer_broadcast_head(broadcast->buffer);
+    size_t head = start;
+    size_t lowest;
+    while ((lowest = channel_broadcast_lowest(broadcast)) != head) {
+        head = lowest;
+        buffer_broadcast_release(broadcast->buffer, head);
+    }
+    return head - start;
+}
+
+// Makes room for the senders of a broadcast channel after a subscription received count values
+// Only the slowest subscriptions can have freed slots: those whose cursor passed the head while
+// reading, which another subscription may have moved up into the values read meanwhile
+static void channel_broadcast_release(channel_t* subscription, size_t count, enum channel_lock_site site)
+{
+    channel_broadcast_t* broadcast = subscription->broadcast;
+    size_t previous = atomic_load_explicit(&subscription->cursor, memory_order_relaxed) - count;
+    if (previous > buffer_broadcast_head(broadcast->buffer)) {
+        return;
+    }
+    pthread_mutex_lock(&broadcast->subscribers_lock);
+    size_t released = channel_broadcast_advance(broadcast);
+    pthread_mutex_unlock(&broadcast->subscribers_lock);
+    if (released > 0) {
+        channel_wake(broadcast->channel, SEND, released, site);
+    }
+}
+
+// Adds data to a buffered channel without blocking and without waking anyone
+// Returns SUCCESS, CHANNEL_FULL or CLOSED_ERROR
+static enum channel_status channel_try_send(channel_t* channel, void* data)
+{
+    if(channel_is_closed(channel)){
+        return CLOSED_ERROR;
+    }
+    if(channel_buffer_add(channel, data) == BUFFER_ERROR){
+        return CHANNEL_FULL;
+    }
+    return SUCCESS;
+}
+
+// Removes data from a buffered channel without blocking and without waking anyone
+// Returns SUCCESS, CHANNEL_EMPTY or CLOSED_ERROR
+static enum channel_status channel_try_receive(channel_t* channel, void** data)
+{
+    if(channel_is_closed(channel)){
+        return CLOSED_ERROR;
+    }
+    if(channel_buffer_remove(channel, data) == BUFFER_ERROR){
+        return CHANNEL_EMPTY;
+    }
+    return SUCCESS;
+}
+
+// Locks two different waiters in address order so that two rendezvous can never deadlock
+static void select_waiter_lock_pair(select_waiter_t* first, select_waiter_t* second)
+{
+    if(first > second){
+        select_waiter_t* temp = first;
+        first = second;
+        second = temp;
+    }
+    pthread_mutex_lock(&first->lock);
+    pthread_mutex_lock(&second->lock);
+}
+
+// Performs the operation of entry on an unbuffered channel by handing the value directly to
+// (or taking it directly from) a waiter registered for the opposite direction
+// self is the waiter of the calling select if it is registered itself, or NULL; the handoff
+// only happens if neither waiter's result has been decided yet
+// site is the call site the handoff is counted under
+// Returns SUCCESS, CHANNEL_EMPTY (CHANNEL_FULL) if there is no waiting counterpart, or CLOSED_ERROR
+static enum channel_status channel_handoff(channel_t* channel, select_t* entry, select_waiter_t* self,
+                                           enum channel_lock_site site)
+{
+    enum channel_status status = CHANNEL_EMPTY;
+    select_waiter_t* woken = NULL;
+    channel_lock(channel, site);
+    if(channel_is_closed(channel)){
+        status = CLOSED_ERROR;
+        if(self){
+            pthread_mutex_lock(&self->lock);
+            if(self->done){
+                status = CHANNEL_EMPTY;
+            }
+            self->done = true;
+            pthread_mutex_unlock(&self->lock);
+        }
+        channel_unlock(channel, site);
+        return status;
+    }
+    for(list_node_t* node = list_begin(channel->selectors); node != NULL; node = list_next(node)){
+        select_registration_t* registration = (select_registration_t*)list_data(node);
+        select_waiter_t* peer = registration->waiter;
+        if(registration->entry->dir == entry->dir || peer == self || atomic_load(&peer->idle)){
+            continue;
+        }
+        if(self){
+            select_waiter_lock_pair(self, peer);
+        } else {
+            pthread_mutex_lock(&peer->lock);
+        }
+        bool self_done = self && self->done;
+        if(!self_done && !peer->done && registration->enabled){
+            // Hand the value over through the waiter's slot; it is woken once MutexLock is released
+            if(entry->dir == SEND){
+                registration->entry->data = entry->data;
+            } else {
+                entry->data = registration->entry->data;
+            }
+            peer->done = true;
+            peer->selected = registration->index;
+            CHANNEL_PROBE(select_notify, channel, registration->entry->dir);
+            atomic_fetch_add_explicit(&peer->holds, 1, memory_order_relaxed);
+            woken = peer;
+            if(self){
+                self->done = true;
+            }
+            CHANNEL_STAT_ADD(channel, wakeups, 1);
+            CHANNEL_STAT_ADD(channel, sends, 1);
+            CHANNEL_STAT_ADD(channel, receives, 1);
+            status = SUCCESS;
+        }
+        pthread_mutex_unlock(&peer->lock);
+        if(self){
+            pthread_mutex_unlock(&self->lock);
+        }
+        if(self_done || status == SUCCESS){
+            break;
+        }
+    }
+    channel_unlock(channel, site);
+    if(woken){
+        select_waiters_notify(&woken, 1);
+    }
+    return status;
+}
+
+// Returns true if the absolute CLOCK_MONOTONIC deadline has passed, never for a NULL deadline
+static bool channel_deadline_passed(const struct timespec* deadline)
+{
+    if(!deadline){
+        return false;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+// Tries the operation of a blocking send (SEND, *data is the value) or receive (RECV) once
+// Returns SUCCESS, CLOSED_ERROR or CHANNEL_EMPTY (CHANNEL_FULL) if the caller has to keep waiting
+static inline enum channel_status channel_spin_try(channel_t* channel, enum direction dir, void** data)
+{
+    if(dir == SEND){
+        return channel_try_send(channel, *data);
+    }
+    return channel_try_receive(channel, data);
+}
+
+// Waits for a full (empty) buffer without parking, as allowed by the channel's wait policy
+// Spins on the buffer for the spin budget, then yields a few times
+// An adaptive channel doubles its budget when the spin succeeds and halves it when it fails
+// A CHANNEL_WAIT_SPIN channel keeps going until the deadline passes (never if it is NULL)
+// Returns the result of the last channel_spin_try
+static enum channel_status channel_spin_wait(channel_t* channel, enum direction dir, void** data,
+                                             const struct timespec* deadline)
+{
+    enum channel_wait_policy policy = channel->wait_policy;
+    if(policy == CHANNEL_WAIT_BLOCK){
+        return CHANNEL_EMPTY;
+    }
+    unsigned budget = channel->spin_max;
+    if(policy == CHANNEL_WAIT_ADAPTIVE){
+        budget = atomic_load_explicit(&channel->spin_budget, memory_order_relaxed);
+    } else if(policy == CHANNEL_WAIT_HYBRID && budget > CHANNEL_SPIN_DEFAULT){
+        budget = CHANNEL_SPIN_DEFAULT;
+    }
+
+    enum channel_status status = CHANNEL_EMPTY;
+    do {
+        for(unsigned i = 0; i < budget; i++){
+            status = channel_spin_try(channel, dir, data);
+            if(status != CHANNEL_EMPTY){
+                if(policy == CHANNEL_WAIT_ADAPTIVE && budget < channel->spin_max){
+                    atomic_store_explicit(&channel->spin_budget, budget * 2, memory_order_relaxed);
+                }
+                return status;
+            }
+            buffer_cpu_relax();
+        }
+        for(unsigned i = 0; i < CHANNEL_YIELD_LIMIT; i++){
+            sched_yield();
+            status = channel_spin_try(channel, dir, data);
+            if(status != CHANNEL_EMPTY){
+                return status;
+            }
+        }
+    } while(policy == CHANNEL_WAIT_SPIN && !channel_deadline_passed(deadline));
+
+    // Spinning did not pay off this time, spend less on it next time
+    if(policy == CHANNEL_WAIT_ADAPTIVE && budget > CHANNEL_SPIN_MIN){
+        atomic_store_explicit(&channel->spin_budget, budget / 2, memory_order_relaxed);
+    }
+    return status;
+}
+
+// Sleeps until the operation of a blocking send (SEND, *data is the value) or receive (RECV)
+// can be performed and performs it, or until the deadline passes (never if it is NULL)
+// Returns SUCCESS, CLOSED_ERROR or TIMEOUT
+static enum channel_status channel_park(channel_t* channel, enum direction dir, void** data,
+                                        const struct timespec* deadline)
+{
+    atomic_uint* word = dir == SEND ? &channel->send_futex : &channel->recv_futex;
+    atomic_size_t* waiters = dir == SEND ? &channel->send_waiters : &channel->recv_waiters;
+    enum channel_status status;
+    bool timed_out = false;
+#ifdef CHANNEL_STATS
+    uint64_t start = channel_stat_now();
+#elif CHANNEL_PROBES
+    uint64_t start = CHANNEL_PROBE_ENABLED(unpark) ? channel_stat_now() : 0;
+#endif
+#ifdef CHANNEL_STATS
+    bool woken = false;
+    if(dir == SEND){
+        CHANNEL_STAT_ADD(channel, send_parks, 1);
+    } else {
+        CHANNEL_STAT_ADD(channel, receive_parks, 1);
+    }
+#endif
+    atomic_fetch_add(waiters, 1);
+    CHANNEL_TRACE_EVENT(channel, dir == SEND ? CHANNEL_TRACE_SEND_PARK : CHANNEL_TRACE_RECEIVE_PARK, 0);
+    CHANNEL_PROBE(park, channel, dir, buffer_current_size(channel->buffer));
+    while(1){
+        // Read the word before retrying so that a wake after the retry makes futex_wait return
+        unsigned seen = atomic_load_explicit(word, memory_order_acquire);
+        status = channel_spin_try(channel, dir, data);
+        if(status != CHANNEL_EMPTY){
+            break;
+        }
+        if(timed_out){
+            status = TIMEOUT;
+            break;
+        }
+        timed_out = futex_wait_until(word, seen, deadline);
+#ifdef CHANNEL_STATS
+        woken = true;
+#endif
+    }
+    atomic_fetch_sub(waiters, 1);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_UNPARK, status);
+    CHANNEL_PROBE(unpark, channel, dir, start ? channel_stat_now() - start : 0, status);
+#ifdef CHANNEL_STATS
+    if(woken && status == SUCCESS){
+        CHANNEL_STAT_ADD(channel, wakeups_with_work, 1);
+    }
+    CHANNEL_STAT_ADD(channel, parked_ns, channel_stat_now() - start);
+#endif
+    return status;
+}
+
+static enum channel_status channel_select_until(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                                size_t start, const struct timespec* deadline, enum channel_lock_site site);
+
+// Writes data to the given channel, waiting for space until the deadline (forever if it is NULL)
+// typed is true for the functions that send a value by address, which only work on typed
+// channels, and false for the ones that send a pointer, which never do
+// Returns SUCCESS, TIMEOUT, CLOSED_ERROR or GEN_ERROR
+static enum channel_status channel_send_until(channel_t* channel, void* data, const struct timespec* deadline, bool typed)
+{
+    if(!channel || !channel_allows(channel, SEND) || channel_is_typed(channel) != typed){
+        return GEN_ERROR;
+    }
+    if(channel_is_closed(channel)){
+        return CLOSED_ERROR;
+    }
+
+    // An unbuffered send waits for a receiver like a select with a single entry
+    if(channel_is_unbuffered(channel)){
+        select_t entry = { channel, SEND, data };
+        size_t index;
+        return channel_select_until(&entry, 1, &index, 0, deadline, CHANNEL_SITE_SEND);
+    }
+
+    // Fast path: there is room in the buffer, no lock needed
+    if(channel_buffer_add(channel, data) == BUFFER_SUCCESS){
+        channel_wake_receiver(channel, CHANNEL_SITE_SEND);
+        return SUCCESS;
+    }
+
+    // Spin for a while if the wait policy allows it
+    enum channel_status status = channel_spin_wait(channel, SEND, &data, deadline);
+    if(status == SUCCESS){
+        channel_wake_receiver(channel, CHANNEL_SITE_SEND);
+    }
+    if(status != CHANNEL_FULL){
+        return status;
+    }
+
+    // Slow path: register as a waiter and sleep until a receiver frees a slot
+    status = channel_park(channel, SEND, &data, deadline);
+    if(status != SUCCESS){
+        return status;
+    }
+
+    // Signal to receive that something new is in the buffer
+    channel_wake_receiver(channel, CHANNEL_SITE_SEND);
+    return SUCCESS;
+}
+
+// Reads data from the given channel, waiting for data until the deadline (forever if it is NULL)
+// typed is true for the functions that copy the value to the address passed as data
+// Returns SUCCESS, TIMEOUT, CLOSED_ERROR or GEN_ERROR
+static enum channel_status channel_receive_until(channel_t* channel, void** data, const struct timespec* deadline, bool typed)
+{
+    if(!channel || !channel_allows(channel, RECV) || channel_is_typed(channel) != typed){
+        return GEN_ERROR;
+    }
+    if(channel_is_closed(channel)){
+        return CLOSED_ERROR;
+    }
+
+    // An unbuffered receive waits for a sender like a select with a single entry
+    if(channel_is_unbuffered(channel)){
+        select_t entry = { channel, RECV, NULL };
+        size_t index;
+        enum channel_status status = channel_select_until(&entry, 1, &index, 0, deadline, CHANNEL_SITE_RECEIVE);
+        if(status == SUCCESS){
+            *data = entry.data;
+        }
+        return status;
+    }
+
+    // Fast path: there is something in the buffer, no lock needed
+    if(channel_buffer_remove(channel, data) == BUFFER_SUCCESS){
+        channel_wake_sender(channel, CHANNEL_SITE_RECEIVE);
+        return SUCCESS;
+    }
+
+    // Spin for a while if the wait policy allows it
+    enum channel_status status = channel_spin_wait(channel, RECV, data, deadline);
+    if(status == SUCCESS){
+        channel_wake_sender(channel, CHANNEL_SITE_RECEIVE);
+    }
+    if(status != CHANNEL_EMPTY){
+        return status;
+    }
+
+    // Slow path: register as a waiter and sleep until a sender fills a slot
+    status = channel_park(channel, RECV, data, deadline);
+    if(status != SUCCESS){
+        return status;
+    }
+
+    // Signal to send that something is no longer in the buffer
+    channel_wake_sender(channel, CHANNEL_SITE_RECEIVE);
+    return SUCCESS;
+}
+
 // Writes data to the given channel
 // This is a blocking call i.e., the function only returns on a successful completion of send
 // In case the channel is full, the function waits till the channel has space to write the new data
@@ -26,27 +1130,10 @@ channel_t* channel_create(size_t size)
 // GEN_ERROR on encountering any other generic error of any sort
 enum channel_status channel_send(channel_t *channel, void* data)
 {
-    // Lock so memmory cannot overlap
-	pthread_mutex_lock(&channel->MutexLock);
-	if(channel->closed == 0){
-		pthread_mutex_unlock(&channel->MutexLock);
-		return CLOSED_ERROR;
-	}
-	else{
-        // Add to the buffer until it has reached its full state
-		while(buffer_add(channel->buffer, data) == BUFFER_ERROR){
-			pthread_cond_wait(&channel->read, &channel->MutexLock);
-			if(channel->closed == 0){
-				pthread_mutex_unlock(&channel->MutexLock);
-				return CLOSED_ERROR;
-			}
-		}
-        // Signal to recieve that something new is in the buffer, and unlock to allow other threads to continue
-		pthread_cond_signal(&channel->write);
-		pthread_mutex_unlock(&channel->MutexLock);
-		return SUCCESS;
-	}
-    return GEN_ERROR;
+    enum channel_status status = channel_send_until(channel, data, NULL, false);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_SEND, status);
+    CHANNEL_PROBE(send, channel, channel_probe_size(channel), status);
+    return status;
 }
 
 // Reads data from the given channel and stores it in the function’s input parameter, data (Note that it is a double pointer).
@@ -55,103 +1142,378 @@ enum channel_status channel_send(channel_t *channel, void* data)
 // Returns SUCCESS for successful retrieval of data,
 // CLOSED_ERROR if the channel is closed, and
 // GEN_ERROR on encountering any other generic error of any sort
-enum channel_status channel_receive(channel_t* channel, void** data)
+enum channel_status channel_receive(channel_t* channel, void** data)
+{
+    enum channel_status status = channel_receive_until(channel, data, NULL, false);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_RECEIVE, status);
+    CHANNEL_PROBE(receive, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Writes data to the given channel, waiting for space until the deadline at the latest (forever if it is NULL)
+// Returns SUCCESS for successfully writing data to the channel,
+// TIMEOUT if the deadline passed before the data could be written,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_send_timed(channel_t* channel, void* data, const struct timespec* deadline)
+{
+    enum channel_status status = channel_send_until(channel, data, deadline, false);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_SEND, status);
+    CHANNEL_PROBE(send, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Reads data from the given channel, waiting for data until the deadline at the latest (forever if it is NULL)
+// Returns SUCCESS for successful retrieval of data,
+// TIMEOUT if the deadline passed before any data arrived,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_receive_timed(channel_t* channel, void** data, const struct timespec* deadline)
+{
+    enum channel_status status = channel_receive_until(channel, data, deadline, false);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_RECEIVE, status);
+    CHANNEL_PROBE(receive, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Writes data to the given channel without waiting, typed as for channel_send_until
+// Returns SUCCESS, CHANNEL_FULL, CLOSED_ERROR or GEN_ERROR
+static enum channel_status channel_send_now(channel_t* channel, void* data, bool typed)
+{
+    // If the channel does not exist (or cannot be sent on this way) return a GEN_ERROR
+    if(!channel || !channel_allows(channel, SEND) || channel_is_typed(channel) != typed){
+        return GEN_ERROR;
+    }
+    // An unbuffered send only succeeds if a receiver is already waiting
+    if(channel_is_unbuffered(channel)){
+        select_t entry = { channel, SEND, data };
+        enum channel_status status = channel_handoff(channel, &entry, NULL, CHANNEL_SITE_NON_BLOCKING);
+        if(status == CHANNEL_FULL){
+            CHANNEL_STAT_ADD(channel, send_full, 1);
+        }
+        return status;
+    }
+    // Return CLOSED_ERROR if the channel is closed and CHANNEL_FULL if there is no space in the buffer
+    enum channel_status status = channel_try_send(channel, data);
+    if(status != SUCCESS){
+        if(status == CHANNEL_FULL){
+            CHANNEL_STAT_ADD(channel, send_full, 1);
+        }
+        return status;
+    }
+    // Signal to receive that something was added to buffer
+    channel_wake_receiver(channel, CHANNEL_SITE_NON_BLOCKING);
+    return SUCCESS;
+}
+
+// Writes data to the given channel
+// This is a non-blocking call i.e., the function simply returns if the channel is full
+// Returns SUCCESS for successfully writing data to the channel,
+// CHANNEL_FULL if the channel is full and the data was not added to the buffer,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_non_blocking_send(channel_t* channel, void* data)
+{
+    return channel_send_now(channel, data, false);
+}
+
+// Reads data from the given channel without waiting, typed as for channel_receive_until
+// Returns SUCCESS, CHANNEL_EMPTY, CLOSED_ERROR or GEN_ERROR
+static enum channel_status channel_receive_now(channel_t* channel, void** data, bool typed)
+{
+    // If the channel does not exist (or cannot be received from this way) return a GEN_ERROR
+    if(!channel || !channel_allows(channel, RECV) || channel_is_typed(channel) != typed){
+        return GEN_ERROR;
+    }
+    // An unbuffered receive only succeeds if a sender is already waiting
+    if(channel_is_unbuffered(channel)){
+        select_t entry = { channel, RECV, NULL };
+        enum channel_status status = channel_handoff(channel, &entry, NULL, CHANNEL_SITE_NON_BLOCKING);
+        if(status == SUCCESS){
+            *data = entry.data;
+        } else if(status == CHANNEL_EMPTY){
+            CHANNEL_STAT_ADD(channel, receive_empty, 1);
+        }
+        return status;
+    }
+    // Return CLOSED_ERROR if the channel is closed and CHANNEL_EMPTY if there is nothing in the buffer
+    enum channel_status status = channel_try_receive(channel, data);
+    if(status != SUCCESS){
+        if(status == CHANNEL_EMPTY){
+            CHANNEL_STAT_ADD(channel, receive_empty, 1);
+        }
+        return status;
+    }
+    // Signal to send that something was removed from buffer
+    channel_wake_sender(channel, CHANNEL_SITE_NON_BLOCKING);
+    return SUCCESS;
+}
+
+// Reads data from the given channel and stores it in the function’s input parameter data (Note that it is a double pointer)
+// This is a non-blocking call i.e., the function simply returns if the channel is empty
+// Returns SUCCESS for successful retrieval of data,
+// CHANNEL_EMPTY if the channel is empty and nothing was stored in data,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_non_blocking_receive(channel_t* channel, void** data)
+{
+    return channel_receive_now(channel, data, false);
+}
+
+// Copies the value at the address value into the given typed channel, waiting for space
+// Returns SUCCESS, CLOSED_ERROR or GEN_ERROR like channel_send
+enum channel_status channel_send_value(channel_t* channel, const void* value)
+{
+    if(!value){
+        return GEN_ERROR;
+    }
+    enum channel_status status = channel_send_until(channel, (void*)value, NULL, true);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_SEND, status);
+    CHANNEL_PROBE(send, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Copies the oldest value of the given typed channel to the address value, waiting for one
+// Returns SUCCESS, CLOSED_ERROR or GEN_ERROR like channel_receive
+enum channel_status channel_receive_value(channel_t* channel, void* value)
+{
+    if(!value){
+        return GEN_ERROR;
+    }
+    // The destination travels where the other kinds pass the address of the received pointer
+    enum channel_status status = channel_receive_until(channel, (void**)value, NULL, true);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_RECEIVE, status);
+    CHANNEL_PROBE(receive, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Same as channel_send_value, but waits until the deadline at the latest
+enum channel_status channel_send_value_timed(channel_t* channel, const void* value, const struct timespec* deadline)
+{
+    if(!value){
+        return GEN_ERROR;
+    }
+    enum channel_status status = channel_send_until(channel, (void*)value, deadline, true);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_SEND, status);
+    CHANNEL_PROBE(send, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Same as channel_receive_value, but waits until the deadline at the latest
+enum channel_status channel_receive_value_timed(channel_t* channel, void* value, const struct timespec* deadline)
+{
+    if(!value){
+        return GEN_ERROR;
+    }
+    enum channel_status status = channel_receive_until(channel, (void**)value, deadline, true);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_RECEIVE, status);
+    CHANNEL_PROBE(receive, channel, channel_probe_size(channel), status);
+    return status;
+}
+
+// Copies the value at the address value into the given typed channel if there is room
+// Returns SUCCESS, CHANNEL_FULL, CLOSED_ERROR or GEN_ERROR like channel_non_blocking_send
+enum channel_status channel_non_blocking_send_value(channel_t* channel, const void* value)
+{
+    return value ? channel_send_now(channel, (void*)value, true) : GEN_ERROR;
+}
+
+// Copies the oldest value of the given typed channel to the address value if there is one
+// Returns SUCCESS, CHANNEL_EMPTY, CLOSED_ERROR or GEN_ERROR like channel_non_blocking_receive
+enum channel_status channel_non_blocking_receive_value(channel_t* channel, void* value)
+{
+    return value ? channel_receive_now(channel, (void**)value, true) : GEN_ERROR;
+}
+
+// Finishes a send whose value the inline fast path of CHANNEL_DEFINE added to the buffer
+void channel_typed_sent(channel_t* channel, bool blocking)
+{
+    if(!blocking){
+        channel_wake_receiver(channel, CHANNEL_SITE_NON_BLOCKING);
+        return;
+    }
+    channel_wake_receiver(channel, CHANNEL_SITE_SEND);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_SEND, SUCCESS);
+    CHANNEL_PROBE(send, channel, channel_probe_size(channel), SUCCESS);
+}
+
+// Finishes a receive whose value the inline fast path of CHANNEL_DEFINE removed from the buffer
+void channel_typed_received(channel_t* channel, bool blocking)
+{
+    if(!blocking){
+        channel_wake_sender(channel, CHANNEL_SITE_NON_BLOCKING);
+        return;
+    }
+    channel_wake_sender(channel, CHANNEL_SITE_RECEIVE);
+    CHANNEL_TRACE_EVENT(channel, CHANNEL_TRACE_RECEIVE, SUCCESS);
+    CHANNEL_PROBE(receive, channel, channel_probe_size(channel), SUCCESS);
+}
+
+// Reads as many values (up to max) from the given channel into out as it can without waiting
+// Returns SUCCESS, CHANNEL_EMPTY, CLOSED_ERROR or GEN_ERROR like channel_non_blocking_receive_many
+// site is the call site the lock acquisitions are counted under
+static enum channel_status channel_receive_available(channel_t* channel, void** out, size_t max, size_t* got,
+                                                     enum channel_lock_site site)
+{
+    size_t done = 0;
+    enum channel_status status = SUCCESS;
+    if(!channel || !channel_allows(channel, RECV) || channel_is_typed(channel) || (!out && max > 0)){
+        status = GEN_ERROR;
+    } else if(channel_is_closed(channel)){
+        status = CLOSED_ERROR;
+    } else if(channel_is_unbuffered(channel)){
+        // Take values over while there are senders waiting
+        while(done < max){
+            select_t entry = { channel, RECV, NULL };
+            if(channel_handoff(channel, &entry, NULL, site) != SUCCESS){
+                break;
+            }
+            out[done++] = entry.data;
+        }
+    } else {
+        done = channel_buffer_remove_many(channel, out, max);
+        if(done > 0){
+            channel_wake_senders(channel, done, site);
+        }
+    }
+    if(status == SUCCESS && done == 0 && max > 0){
+        status = channel_is_closed(channel) ? CLOSED_ERROR : CHANNEL_EMPTY;
+    }
+    if(got){
+        *got = done;
+    }
+    return status;
+}
+
+// Writes the n values of items to the given channel in order
+// This is a blocking call i.e., the function only returns once all values were written or the channel is closed
+// Returns SUCCESS once all n values were written,
+// CLOSED_ERROR if the channel is closed before that, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case sent (if not NULL) is set to the number of values that were written
+enum channel_status channel_send_many(channel_t* channel, void** items, size_t n, size_t* sent)
+{
+    size_t done = 0;
+    enum channel_status status = SUCCESS;
+    if(!channel || !channel_allows(channel, SEND) || channel_is_typed(channel) || (!items && n > 0)){
+        status = GEN_ERROR;
+    }
+    while(status == SUCCESS && done < n){
+        // Move as much of the rest as fits, then park for a single value when the buffer is full
+        // The unbuffered case skips straight to the rendezvous in channel_send
+        if(!channel_is_unbuffered(channel)){
+            if(channel_is_closed(channel)){
+                status = CLOSED_ERROR;
+                break;
+            }
+            size_t added = channel_buffer_add_many(channel, items + done, n - done);
+            if(added > 0){
+                done += added;
+                channel_wake_receivers(channel, added, CHANNEL_SITE_SEND);
+                continue;
+            }
+        }
+        status = channel_send(channel, items[done]);
+        if(status == SUCCESS){
+            done++;
+        }
+    }
+    if(sent){
+        *sent = done;
+    }
+    return status;
+}
+
+// Reads up to max values from the given channel into out, in the order they were sent
+// This is a blocking call i.e., the function waits till the channel has at least one value to read
+// and then takes as many of the available values as fit into out
+// Returns SUCCESS once at least one value was read (or max is 0),
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case got (if not NULL) is set to the number of values that were read
+enum channel_status channel_receive_many(channel_t* channel, void** out, size_t max, size_t* got)
 {
-    // Lock so memmory cannot overlap
-	pthread_mutex_lock(&channel->MutexLock);
-	if(channel->closed == 0){
-		pthread_mutex_unlock(&channel->MutexLock);
-		return CLOSED_ERROR;
-	}
-	else{
-        // Remove from the buffer until it has reached its empty state
-		while(buffer_remove(channel->buffer, data) == BUFFER_ERROR){
-			pthread_cond_wait(&channel->write, &channel->MutexLock);
-			if(channel->closed == 0){
-				pthread_mutex_unlock(&channel->MutexLock);
-				return CLOSED_ERROR;
-			}
-		}
-        // Signal to send that something is no longer in the buffer, and unlock to allow other threads to continue
-        pthread_cond_signal(&channel->read);
-		pthread_mutex_unlock(&channel->MutexLock);
-		return SUCCESS;
-	}
+    size_t done = 0;
+    enum channel_status status = SUCCESS;
+    if(!channel || (!out && max > 0)){
+        status = GEN_ERROR;
+    } else if(max > 0){
+        status = channel_receive_available(channel, out, max, &done, CHANNEL_SITE_RECEIVE);
+        if(status == CHANNEL_EMPTY){
+            // Nothing available yet, park for the first value and then take whatever followed it
+            status = channel_receive(channel, &out[0]);
+            if(status == SUCCESS){
+                size_t more = 0;
+                channel_receive_available(channel, out + 1, max - 1, &more, CHANNEL_SITE_RECEIVE);
+                done = 1 + more;
+            }
+        }
+    }
+    if(got){
+        *got = done;
+    }
+    return status;
 }
 
-// Writes data to the given channel
-// This is a non-blocking call i.e., the function simply returns if the channel is full
-// Returns SUCCESS for successfully writing data to the channel,
-// CHANNEL_FULL if the channel is full and the data was not added to the buffer,
+// Writes as many of the n values of items to the given channel as it can without waiting
+// Returns SUCCESS if at least one value was written (all n if n is 0),
+// CHANNEL_FULL if the channel is full and nothing was written,
 // CLOSED_ERROR if the channel is closed, and
 // GEN_ERROR on encountering any other generic error of any sort
-enum channel_status channel_non_blocking_send(channel_t* channel, void* data)
+// In every case sent (if not NULL) is set to the number of values that were written
+enum channel_status channel_non_blocking_send_many(channel_t* channel, void** items, size_t n, size_t* sent)
 {
-    // If the channel does not exist return a GEN_ERROR
-    if(!channel){
-        // pthread_cond_signal(&channel->write);
-		return GEN_ERROR;
-	}
-    // Lock the memory and check if the channel is closed, and if so unlock and return CLOSED_ERROR
-	pthread_mutex_lock(&channel->MutexLock);
-	if(channel->closed == 0){
-		pthread_mutex_unlock(&channel->MutexLock);	
-		return CLOSED_ERROR;
-	}
-    // If there is no space in the buffer to add, return CHANNEL_FULL
-	if(buffer_current_size(channel->buffer) >= buffer_capacity(channel->buffer)){
-		pthread_mutex_unlock(&channel->MutexLock);
-		return CHANNEL_FULL;
-	}
-    // Add to the buffer, unlock, and signal to recieve that something was added to buffer
-	else{
-		buffer_add(channel->buffer, data);
-        pthread_cond_signal(&channel->write);
-		pthread_mutex_unlock(&channel->MutexLock);
-		return SUCCESS;		
-	}
-    return SUCCESS;
+    size_t done = 0;
+    enum channel_status status = SUCCESS;
+    if(!channel || !channel_allows(channel, SEND) || channel_is_typed(channel) || (!items && n > 0)){
+        status = GEN_ERROR;
+    } else if(channel_is_closed(channel)){
+        status = CLOSED_ERROR;
+    } else if(channel_is_unbuffered(channel)){
+        // Hand values over while there are receivers waiting
+        while(done < n){
+            select_t entry = { channel, SEND, items[done] };
+            if(channel_handoff(channel, &entry, NULL, CHANNEL_SITE_NON_BLOCKING) != SUCCESS){
+                break;
+            }
+            done++;
+        }
+    } else {
+        done = channel_buffer_add_many(channel, items, n);
+        if(done > 0){
+            channel_wake_receivers(channel, done, CHANNEL_SITE_NON_BLOCKING);
+        }
+    }
+    if(status == SUCCESS && done == 0 && n > 0){
+        status = channel_is_closed(channel) ? CLOSED_ERROR : CHANNEL_FULL;
+        if(status == CHANNEL_FULL){
+            CHANNEL_STAT_ADD(channel, send_full, 1);
+        }
+    }
+    if(sent){
+        *sent = done;
+    }
+    return status;
 }
 
-// Reads data from the given channel and stores it in the function’s input parameter data (Note that it is a double pointer)
-// This is a non-blocking call i.e., the function simply returns if the channel is empty
-// Returns SUCCESS for successful retrieval of data,
-// CHANNEL_EMPTY if the channel is empty and nothing was stored in data,
+// Reads as many values (up to max) from the given channel into out as it can without waiting
+// Returns SUCCESS if at least one value was read (or max is 0),
+// CHANNEL_EMPTY if the channel is empty and nothing was read,
 // CLOSED_ERROR if the channel is closed, and
 // GEN_ERROR on encountering any other generic error of any sort
-enum channel_status channel_non_blocking_receive(channel_t* channel, void** data)
+// In every case got (if not NULL) is set to the number of values that were read
+enum channel_status channel_non_blocking_receive_many(channel_t* channel, void** out, size_t max, size_t* got)
 {
-    // If the channel does not exist return a GEN_ERROR
-    if(!channel){
-	    return GEN_ERROR;
+    enum channel_status status = channel_receive_available(channel, out, max, got, CHANNEL_SITE_NON_BLOCKING);
+    if(status == CHANNEL_EMPTY){
+        CHANNEL_STAT_ADD(channel, receive_empty, 1);
     }
-    // Lock the memory and check if the channel is closed, and if so unlock and return CLOSED_ERROR
-	pthread_mutex_lock(&channel->MutexLock);
-	if(channel->closed == 0){
-		pthread_mutex_unlock(&channel->MutexLock);
-		return CLOSED_ERROR;
-	}
-    // If there is nothing in the buffer to remove, return CHANNEL_EMPTY
-	if(buffer_current_size(channel->buffer)  == 0){
-		pthread_mutex_unlock(&channel->MutexLock);	
-		return CHANNEL_EMPTY;
-	}
-    // Remove from the buffer, unlock, and signal to send that something was removed from buffer
-	else{
-		buffer_remove(channel->buffer, data);
-        pthread_cond_signal(&channel->read);
-		pthread_mutex_unlock(&channel->MutexLock);
-		return SUCCESS;
-	}
-    return SUCCESS;
+    return status;
 }
 
-// Closes the channel and informs all the blocking send/receive/select calls to return with CLOSED_ERROR
-// Once the channel is closed, send/receive/select operations will cease to function and just return CLOSED_ERROR
-// Returns SUCCESS if close is successful,
-// CLOSED_ERROR if the channel is already closed, and
-// GEN_ERROR in any other error case
-enum channel_status channel_close(channel_t* channel)
+// Closes the channel and wakes all the blocking send/receive/select calls on it
+// Returns SUCCESS, or CLOSED_ERROR if the channel is already closed
+static enum channel_status channel_mark_closed(channel_t* channel)
 {
     // If the channel does not exist, return GEN_ERROR
 	if(!channel){
@@ -159,23 +1521,132 @@ enum channel_status channel_close(channel_t* channel)
     }
 
     // Lock the memory, and check if the channel is already closed
-    pthread_mutex_lock(&channel->MutexLock);
-    if(channel->closed == 0){
-        pthread_mutex_unlock(&channel->MutexLock);
+    channel_lock(channel, CHANNEL_SITE_CLOSE);
+    if(channel_is_closed(channel)){
+        channel_unlock(channel, CHANNEL_SITE_CLOSE);
 		return CLOSED_ERROR;
 	}
 
     // Close the channel
-	channel->closed = 0;
+	atomic_store_explicit(&channel->closed, 0, memory_order_release);
     
-    // Wake all sleeping threads and unlock the memory
-	pthread_cond_broadcast(&channel->write);
-	pthread_cond_broadcast(&channel->read);
-    pthread_mutex_unlock(&channel->MutexLock);
+    // Wake all sleeping threads, and unlock the memory
+    atomic_fetch_add(&channel->recv_futex, 1);
+    atomic_fetch_add(&channel->send_futex, 1);
+    futex_wake(&channel->recv_futex, FUTEX_WAKE_ALL);
+    futex_wake(&channel->send_futex, FUTEX_WAKE_ALL);
+    channel_unlock(channel, CHANNEL_SITE_CLOSE);
+
+    // Wake every select; one that registers from now on finds the channel closed on its own,
+    // and one that is still pending is about to look at its channels anyway
+    // The counts are read as in channel_wake_sleepers: a select counted after the read sees the close
+    if(atomic_fetch_add(&channel->recv_selects, 0) > 0){
+        channel_notify_selectors(channel, RECV, SIZE_MAX, CHANNEL_SITE_CLOSE);
+    }
+    if(atomic_fetch_add(&channel->send_selects, 0) > 0){
+        channel_notify_selectors(channel, SEND, SIZE_MAX, CHANNEL_SITE_CLOSE);
+    }
+    CHANNEL_PROBE(close, channel, buffer_current_size(channel->buffer));
 
 	return SUCCESS;
 }
 
+// Subscribes to a broadcast channel and returns the subscription, or NULL if broadcast is not
+// an open broadcast channel
+channel_t* channel_subscribe(channel_t* broadcast)
+{
+    if(!broadcast || broadcast->kind != CHANNEL_BROADCAST){
+        return NULL;
+    }
+    channel_broadcast_t* state = broadcast->broadcast;
+    channel_attr_t attr;
+    channel_attr_init(&attr);
+    attr.kind = CHANNEL_SUBSCRIPTION;
+    attr.wait_policy = broadcast->wait_policy;
+    atomic_fetch_add(&state->references, 1);
+    channel_t* subscription = channel_create_buffer(state->buffer, &attr, state);
+    if(!subscription){
+        // The broadcast channel holds a reference of its own, so this was not the last one
+        atomic_fetch_sub(&state->references, 1);
+        return NULL;
+    }
+
+    // A close of the broadcast channel either sees the subscription in the list or is seen here
+    pthread_mutex_lock(&state->subscribers_lock);
+    if(channel_is_closed(broadcast)){
+        pthread_mutex_unlock(&state->subscribers_lock);
+        channel_mark_closed(subscription);
+        channel_destroy(subscription);
+        return NULL;
+    }
+    // Holding publish_lock, no send is halfway through adding a value the new cursor would skip
+    pthread_mutex_lock(&state->publish_lock);
+    size_t tail = buffer_broadcast_tail(state->buffer);
+    atomic_store(&subscription->cursor, tail);
+    if(state->subscriber_count++ == 0){
+        // Nobody held the values sent since the last subscription left
+        buffer_broadcast_release(state->buffer, tail);
+    }
+    pthread_mutex_unlock(&state->publish_lock);
+    list_insert(state->subscribers, subscription);
+    pthread_mutex_unlock(&state->subscribers_lock);
+    return subscription;
+}
+
+// Removes a closed subscription from its broadcast channel and lets the senders overwrite the
+// values only it still held back
+static void channel_unsubscribe(channel_t* subscription)
+{
+    channel_broadcast_t* state = subscription->broadcast;
+    pthread_mutex_lock(&state->subscribers_lock);
+    // Not in the list any more if the broadcast channel was closed meanwhile
+    list_node_t* node = list_find(state->subscribers, subscription);
+    size_t released = 0;
+    if(node){
+        list_remove(state->subscribers, node);
+        pthread_mutex_lock(&state->publish_lock);
+        state->subscriber_count--;
+        pthread_mutex_unlock(&state->publish_lock);
+        released = channel_broadcast_advance(state);
+    }
+    pthread_mutex_unlock(&state->subscribers_lock);
+    if(released > 0){
+        channel_wake(state->channel, SEND, released, CHANNEL_SITE_CLOSE);
+    }
+}
+
+// Closes every subscription of a closed broadcast channel
+static void channel_broadcast_close(channel_broadcast_t* state)
+{
+    pthread_mutex_lock(&state->subscribers_lock);
+    list_node_t* node;
+    while((node = list_begin(state->subscribers)) != NULL){
+        channel_mark_closed((channel_t*)list_data(node));
+        list_remove(state->subscribers, node);
+    }
+    pthread_mutex_lock(&state->publish_lock);
+    state->subscriber_count = 0;
+    pthread_mutex_unlock(&state->publish_lock);
+    pthread_mutex_unlock(&state->subscribers_lock);
+}
+
+// Closes the channel and informs all the blocking send/receive/select calls to return with CLOSED_ERROR
+// Once the channel is closed, send/receive/select operations will cease to function and just return CLOSED_ERROR
+// Closing a broadcast channel closes its subscriptions, closing a subscription unsubscribes it
+// Returns SUCCESS if close is successful,
+// CLOSED_ERROR if the channel is already closed, and
+// GEN_ERROR in any other error case
+enum channel_status channel_close(channel_t* channel)
+{
+    enum channel_status status = channel_mark_closed(channel);
+    if(status == SUCCESS && channel->kind == CHANNEL_BROADCAST){
+        channel_broadcast_close(channel->broadcast);
+    } else if(status == SUCCESS && channel->kind == CHANNEL_SUBSCRIPTION){
+        channel_unsubscribe(channel);
+    }
+    return status;
+}
+
 // Frees all the memory allocated to the channel
 // The caller is responsible for calling channel_close and waiting for all threads to finish their tasks before calling channel_destroy
 // Returns SUCCESS if destroy is successful,
@@ -184,22 +1655,401 @@ enum channel_status channel_close(channel_t* channel)
 enum channel_status channel_destroy(channel_t* channel)
 {
     // If the channel is open return a DESTROY_ERROR
-    if(channel->closed == 1){
+    if(!channel_is_closed(channel)){
 		return DESTROY_ERROR;
 	}
 
-    // Destroy the lock and conditional variables
+    channel_registry_remove(channel);
+
+    // Destroy the lock
 	pthread_mutex_destroy(&channel->MutexLock);
-    pthread_cond_destroy(&channel->read);
-    pthread_cond_destroy(&channel->write);
+#ifdef CHANNEL_STATS
+    free(channel->stats);
+#endif
 
     // Free the buffer and channel from memory
-    buffer_free(channel->buffer);
+    list_destroy(channel->selectors);
+    if(!channel->broadcast){
+        buffer_free(channel->buffer);
+    } else if(atomic_fetch_sub(&channel->broadcast->references, 1) == 1){
+        // The broadcast channel and all of its subscriptions are gone
+        channel_broadcast_t* state = channel->broadcast;
+        pthread_mutex_destroy(&state->publish_lock);
+        pthread_mutex_destroy(&state->subscribers_lock);
+        list_destroy(state->subscribers);
+        buffer_free(state->buffer);
+        free(state);
+    }
+    histogram_free(channel->latency);
 	free(channel);
 
     return SUCCESS;
 }
 
+// Stores a snapshot of the channel's counters in stats
+// Returns SUCCESS if the snapshot was taken, and
+// GEN_ERROR if the channel was built without CHANNEL_STATS or on any other error
+enum channel_status channel_get_stats(channel_t* channel, channel_stats_t* stats)
+{
+    if(!channel || !stats){
+        return GEN_ERROR;
+    }
+#ifdef CHANNEL_STATS
+    memset(stats, 0, sizeof(channel_stats_t));
+    for(size_t i = 0; i < CHANNEL_STATS_SHARDS; i++){
+        struct channel_stats_shard* shard = &channel->stats[i];
+        stats->sends += atomic_load_explicit(&shard->sends, memory_order_relaxed);
+        stats->receives += atomic_load_explicit(&shard->receives, memory_order_relaxed);
+        stats->send_full += atomic_load_explicit(&shard->send_full, memory_order_relaxed);
+        stats->receive_empty += atomic_load_explicit(&shard->receive_empty, memory_order_relaxed);
+        stats->send_parks += atomic_load_explicit(&shard->send_parks, memory_order_relaxed);
+        stats->receive_parks += atomic_load_explicit(&shard->receive_parks, memory_order_relaxed);
+        stats->parked_ns += atomic_load_explicit(&shard->parked_ns, memory_order_relaxed);
+        stats->wakeups += atomic_load_explicit(&shard->wakeups, memory_order_relaxed);
+        stats->wakeups_with_work += atomic_load_explicit(&shard->wakeups_with_work, memory_order_relaxed);
+        size_t peak = atomic_load_explicit(&shard->peak_size, memory_order_relaxed);
+        if(peak > stats->peak_size){
+            stats->peak_size = peak;
+        }
+        for(size_t site = 0; site < CHANNEL_SITES; site++){
+            channel_lock_stats_t* lock = &stats->locks[site];
+            lock->acquisitions += atomic_load_explicit(&shard->lock_acquisitions[site], memory_order_relaxed);
+            lock->contended += atomic_load_explicit(&shard->lock_contended[site], memory_order_relaxed);
+            lock->wait_ns += atomic_load_explicit(&shard->lock_wait_ns[site], memory_order_relaxed);
+            lock->hold_ns += atomic_load_explicit(&shard->lock_hold_ns[site], memory_order_relaxed);
+        }
+    }
+    return SUCCESS;
+#else
+    return GEN_ERROR;
+#endif
+}
+
+// Stores the number of values a conflating channel dropped for a newer one in superseded
+// Returns SUCCESS, or GEN_ERROR if the channel is not a conflating channel
+enum channel_status channel_get_superseded(channel_t* channel, uint64_t* superseded)
+{
+    if(!channel || !superseded || channel->kind != CHANNEL_CONFLATING){
+        return GEN_ERROR;
+    }
+    *superseded = atomic_load_explicit(&channel->dropped, memory_order_relaxed);
+    return SUCCESS;
+}
+
+// Stores the number of values a lossy channel dropped to make room for newer ones in dropped
+// Returns SUCCESS, or GEN_ERROR if the channel is not a lossy channel
+enum channel_status channel_get_dropped(channel_t* channel, uint64_t* dropped)
+{
+    if(!channel || !dropped || channel->kind != CHANNEL_LOSSY){
+        return GEN_ERROR;
+    }
+    *dropped = atomic_load_explicit(&channel->dropped, memory_order_relaxed);
+    return SUCCESS;
+}
+
+// Stores the sojourn time percentiles of the values that went through the channel's buffer in latency
+// Returns SUCCESS if the percentiles were stored, and
+// GEN_ERROR if the channel does not record latency or on any other error
+enum channel_status channel_get_latency(channel_t* channel, channel_latency_t* latency)
+{
+    if(!channel || !latency || !channel->latency){
+        return GEN_ERROR;
+    }
+    double ns_per_tick = histogram_ns_per_tick(channel->latency);
+    latency->count = histogram_count(channel->latency);
+    latency->p50_ns = (uint64_t)((double)histogram_percentile(channel->latency, 0.5) * ns_per_tick);
+    latency->p99_ns = (uint64_t)((double)histogram_percentile(channel->latency, 0.99) * ns_per_tick);
+    latency->p999_ns = (uint64_t)((double)histogram_percentile(channel->latency, 0.999) * ns_per_tick);
+    latency->max_ns = (uint64_t)((double)histogram_max(channel->latency) * ns_per_tick);
+    return SUCCESS;
+}
+
+// Ends a registered select with the error status found on one of its entries, so that no
+// rendezvous can complete it once it stopped looking at its channels
+// Returns CHANNEL_EMPTY instead if a rendezvous completed the select first, so that its result
+// is reported; an unregistered select (NULL self) just gets status back
+static enum channel_status select_fail(select_waiter_t* self, enum channel_status status)
+{
+    if(self){
+        pthread_mutex_lock(&self->lock);
+        if(self->done){
+            status = CHANNEL_EMPTY;
+        }
+        self->done = true;
+        pthread_mutex_unlock(&self->lock);
+    }
+    return status;
+}
+
+// Performs the operation of one select entry without blocking
+// self is the waiter of the calling select once it is registered, or NULL before that; a
+// registered select may be completed by a rendezvous at any time, so its own operations
+// are only attempted while its result is still undecided
+// site is the call site the lock acquisitions are counted under
+// Returns CHANNEL_EMPTY (CHANNEL_FULL) if the operation cannot be performed right now
+static enum channel_status select_attempt(select_t* entry, select_waiter_t* self, enum channel_lock_site site)
+{
+    channel_t* channel = entry->channel;
+    if(!channel || !channel_allows(channel, entry->dir)){
+        return select_fail(self, GEN_ERROR);
+    }
+    if(channel_is_unbuffered(channel)){
+        return channel_handoff(channel, entry, self, site);
+    }
+    // The data of a typed entry is the address of the value in both directions
+    bool typed = channel_is_typed(channel);
+    if(typed && !entry->data){
+        return select_fail(self, GEN_ERROR);
+    }
+    if(self){
+        pthread_mutex_lock(&self->lock);
+        if(self->done){
+            pthread_mutex_unlock(&self->lock);
+            return CHANNEL_EMPTY;
+        }
+    }
+    enum channel_status status;
+    if(entry->dir == SEND){
+        status = channel_try_send(channel, entry->data);
+    } else {
+        status = channel_try_receive(channel, typed ? (void**)entry->data : &entry->data);
+    }
+    if(self){
+        if(status != CHANNEL_EMPTY){
+            self->done = true;
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    // Wake the other side only after the waiter lock is released, waiter locks are
+    // always taken after MutexLock and never the other way around
+    if(status == SUCCESS){
+        if(entry->dir == SEND){
+            channel_wake_receiver(channel, site);
+        } else {
+            channel_wake_sender(channel, site);
+        }
+    }
+    return status;
+}
+
+// Returns SUCCESS with selected_index set to the entry a rendezvous completed if the registered
+// select of self was completed by one, CHANNEL_EMPTY otherwise (also for a NULL self)
+static enum channel_status select_decided(select_waiter_t* self, size_t* selected_index)
+{
+    enum channel_status status = CHANNEL_EMPTY;
+    if(self){
+        pthread_mutex_lock(&self->lock);
+        if(self->done){
+            *selected_index = self->selected;
+            status = SUCCESS;
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+    return status;
+}
+
+// Performs the first operation in the list, starting at index start and wrapping around,
+// that can complete without blocking
+// Returns CHANNEL_EMPTY if none of them can, otherwise the status of the operation
+// performed (or the error encountered) with selected_index set to its position
+// A registered select also returns SUCCESS if a rendezvous completed it meanwhile
+static enum channel_status select_try(select_t* channel_list, size_t channel_count, size_t* selected_index, select_waiter_t* self,
+                                      size_t start, enum channel_lock_site site)
+{
+    for(size_t k = 0; k < channel_count; k++){
+        size_t i = start + k < channel_count ? start + k : start + k - channel_count;
+        enum channel_status status = select_attempt(&channel_list[i], self, site);
+        if(status != CHANNEL_EMPTY){
+            *selected_index = i;
+            return status;
+        }
+    }
+    return select_decided(self, selected_index);
+}
+
+// Counts (waiting true) or uncounts a registration as a waiting select so that the fast paths
+// of the opposite direction know to notify it
+static inline void select_count_waiting(channel_t* channel, select_registration_t* registration, bool waiting)
+{
+    atomic_size_t* selects = registration->entry->dir == SEND ? &channel->send_selects : &channel->recv_selects;
+    if(waiting){
+        atomic_fetch_add(selects, 1);
+    } else {
+        atomic_fetch_sub(selects, 1);
+    }
+}
+
+// Adds a select registration to the channel's list without counting it as waiting
+static void select_link(channel_t* channel, select_registration_t* registration, enum channel_lock_site site)
+{
+    channel_lock(channel, site);
+    list_insert(channel->selectors, registration);
+    channel_unlock(channel, site);
+}
+
+// Removes a select registration from the channel's list
+static void select_unlink(channel_t* channel, select_registration_t* registration, enum channel_lock_site site)
+{
+    channel_lock(channel, site);
+    list_remove(channel->selectors, list_find(channel->selectors, registration));
+    channel_unlock(channel, site);
+}
+
+// Adds a select registration to the channel and counts it as waiting
+static void select_register(channel_t* channel, select_registration_t* registration, enum channel_lock_site site)
+{
+    select_link(channel, registration, site);
+    select_count_waiting(channel, registration, true);
+}
+
+// Removes a select registration from the channel
+static void select_unregister(channel_t* channel, select_registration_t* registration, enum channel_lock_site site)
+{
+    select_count_waiting(channel, registration, false);
+    select_unlink(channel, registration, site);
+}
+
+// Takes the event a send or receive handed the registration, if any, once its select woke up
+// and is about to look at its channels again
+static inline void select_registration_take(select_registration_t* registration)
+{
+    registration->handed = atomic_exchange(&registration->pending, false);
+}
+
+// Passes the event handed to a registration of a select that is done on to the other waiters of
+// its channel, unless the select used it to perform the registration's operation (performed);
+// an event handed after the select last looked at its channels is always passed on
+// Must only be called once no send or receive can hand the registration an event anymore
+static void select_registration_pass_on(select_registration_t* registration, bool performed,
+                                        enum channel_lock_site site)
+{
+    bool late = atomic_exchange(&registration->pending, false);
+    bool unused = late || (registration->handed && !performed);
+    registration->handed = false;
+    if(unused){
+        channel_wake_sleepers(registration->entry->channel, registration->entry->dir, 1, site);
+    }
+}
+
+// Initializes a waiter whose condition variable measures deadlines on CLOCK_MONOTONIC like the futex waits
+// A waiter that starts out done (the one of a select set) also starts out idle
+static void select_waiter_init(select_waiter_t* waiter, bool done)
+{
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&waiter->lock, NULL);
+    pthread_cond_init(&waiter->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    waiter->notified = false;
+    waiter->done = done;
+    waiter->selected = 0;
+    atomic_init(&waiter->holds, 0);
+    atomic_init(&waiter->idle, done);
+}
+
+// Destroys a waiter once it is unregistered from every channel, after the threads that
+// collected it before that (see channel_collect_selectors) have notified it
+static void select_waiter_destroy(select_waiter_t* waiter)
+{
+    while (atomic_load_explicit(&waiter->holds, memory_order_acquire) > 0) {
+        sched_yield();
+    }
+    pthread_cond_destroy(&waiter->cond);
+    pthread_mutex_destroy(&waiter->lock);
+}
+
+// Sleeps until the waiter is notified or completed by a rendezvous, or the deadline passes
+// (never if it is NULL)
+// On timeout the select decides its own result so that no rendezvous can complete it
+// anymore; one that already did wins over the timeout
+// Returns true if the select timed out
+static bool select_waiter_wait(select_waiter_t* waiter, const struct timespec* deadline)
+{
+    bool timed_out = false;
+    pthread_mutex_lock(&waiter->lock);
+    while(!waiter->notified && !waiter->done && !timed_out){
+        if(!deadline){
+            pthread_cond_wait(&waiter->cond, &waiter->lock);
+        } else if(pthread_cond_timedwait(&waiter->cond, &waiter->lock, deadline) == ETIMEDOUT){
+            timed_out = true;
+        }
+    }
+    timed_out = timed_out && !waiter->done;
+    if(timed_out){
+        waiter->done = true;
+    }
+    waiter->notified = false;
+    pthread_mutex_unlock(&waiter->lock);
+    return timed_out;
+}
+
+// Performs channel_select, waiting until the deadline (forever if it is NULL)
+// Every scan of the list starts at index start (less than channel_count, or 0)
+// site is the call site the lock acquisitions are counted under
+static enum channel_status channel_select_until(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                                size_t start, const struct timespec* deadline, enum channel_lock_site site)
+{
+    // An empty list has no channel to register on, so nothing could ever wake it
+    if(!channel_list || !selected_index || channel_count == 0){
+        return GEN_ERROR;
+    }
+
+    // Fast path: one of the operations can be performed right away
+    enum channel_status status = select_try(channel_list, channel_count, selected_index, NULL, start, site);
+    if(status != CHANNEL_EMPTY){
+        return status;
+    }
+
+    // Slow path: register one waiter on every channel, then retry each time it is notified
+    select_waiter_t waiter;
+    select_waiter_init(&waiter, false);
+    select_registration_t* registrations = (select_registration_t*)malloc(sizeof(select_registration_t) * channel_count);
+    if(!registrations){
+        select_waiter_destroy(&waiter);
+        return GEN_ERROR;
+    }
+    for(size_t i = 0; i < channel_count; i++){
+        registrations[i].waiter = &waiter;
+        registrations[i].entry = &channel_list[i];
+        registrations[i].index = i;
+        registrations[i].enabled = true;
+        atomic_init(&registrations[i].pending, false);
+        registrations[i].handed = false;
+        select_register(channel_list[i].channel, &registrations[i], site);
+    }
+    CHANNEL_TRACE_EVENT(channel_count == 1 ? channel_list[0].channel : NULL,
+                        site == CHANNEL_SITE_SEND ? CHANNEL_TRACE_SEND_PARK :
+                        site == CHANNEL_SITE_RECEIVE ? CHANNEL_TRACE_RECEIVE_PARK : CHANNEL_TRACE_SELECT_PARK, 0);
+    CHANNEL_PROBE(select_park, channel_list, channel_count);
+#if CHANNEL_PROBES
+    uint64_t parked_at = CHANNEL_PROBE_ENABLED(select_unpark) ? channel_stat_now() : 0;
+#endif
+
+    while((status = select_try(channel_list, channel_count, selected_index, &waiter, start, site)) == CHANNEL_EMPTY){
+        if(select_waiter_wait(&waiter, deadline)){
+            status = TIMEOUT;
+            break;
+        }
+        for(size_t i = 0; i < channel_count; i++){
+            select_registration_take(&registrations[i]);
+        }
+    }
+
+    CHANNEL_TRACE_EVENT(channel_count == 1 ? channel_list[0].channel : NULL, CHANNEL_TRACE_UNPARK, status);
+    CHANNEL_PROBE(select_unpark, channel_list, channel_count, parked_at ? channel_stat_now() - parked_at : 0, status);
+    for(size_t i = 0; i < channel_count; i++){
+        select_unregister(channel_list[i].channel, &registrations[i], site);
+    }
+    for(size_t i = 0; i < channel_count; i++){
+        select_registration_pass_on(&registrations[i], status == SUCCESS && *selected_index == i, site);
+    }
+    free(registrations);
+    select_waiter_destroy(&waiter);
+    return status;
+}
+
 // Takes an array of channels, channel_list, of type select_t and the array length, channel_count, as inputs
 // This API iterates over the provided list and finds the set of possible channels which can be used to invoke the required operation (send or receive) specified in select_t
 // If multiple options are available, it selects the first option and performs its corresponding action
@@ -207,8 +2057,362 @@ enum channel_status channel_destroy(channel_t* channel)
 // Once an operation has been successfully performed, select should set selected_index to the index of the channel that performed the operation and then return SUCCESS
 // In the event that a channel is closed or encounters any error, the error should be propagated and returned through select
 // Additionally, selected_index is set to the index of the channel that generated the error
+// Returns GEN_ERROR for an empty list
 enum channel_status channel_select(select_t* channel_list, size_t channel_count, size_t* selected_index)
 {
-    /* IMPLEMENT THIS */
+    enum channel_status status = channel_select_until(channel_list, channel_count, selected_index, 0, NULL, CHANNEL_SITE_SELECT);
+    CHANNEL_TRACE_EVENT(status == SUCCESS || status == CLOSED_ERROR ? channel_list[*selected_index].channel : NULL,
+                        CHANNEL_TRACE_SELECT, status);
+    return status;
+}
+
+// Same as channel_select, but makes one pass over the list and never waits
+// Returns SUCCESS, CHANNEL_EMPTY if none of the operations could be performed right now,
+// CLOSED_ERROR or GEN_ERROR
+enum channel_status channel_select_non_blocking(select_t* channel_list, size_t channel_count, size_t* selected_index)
+{
+    if(!channel_list || !selected_index){
+        return GEN_ERROR;
+    }
+    enum channel_status status = select_try(channel_list, channel_count, selected_index, NULL, 0, CHANNEL_SITE_NON_BLOCKING);
+    CHANNEL_TRACE_EVENT(status == SUCCESS || status == CLOSED_ERROR ? channel_list[*selected_index].channel : NULL,
+                        CHANNEL_TRACE_SELECT, status);
+    return status;
+}
+
+// Same as channel_select, but waits until the deadline at the latest
+// Returns TIMEOUT if the deadline passed before any of the operations could be performed
+// A NULL deadline waits forever
+enum channel_status channel_select_timed(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                         const struct timespec* deadline)
+{
+    enum channel_status status = channel_select_until(channel_list, channel_count, selected_index, 0, deadline, CHANNEL_SITE_SELECT);
+    CHANNEL_TRACE_EVENT(status == SUCCESS || status == CLOSED_ERROR ? channel_list[*selected_index].channel : NULL,
+                        CHANNEL_TRACE_SELECT, status);
+    return status;
+}
+
+// Same as channel_select_timed, but also performs up to max_completed - 1 more operations that
+// are ready once the first one has been performed
+// Returns SUCCESS with completed_count set to the number of entries performed, TIMEOUT,
+// CLOSED_ERROR or GEN_ERROR
+enum channel_status channel_select_ready(select_t* channel_list, size_t channel_count, size_t* completed,
+                                         size_t max_completed, size_t* completed_count,
+                                         const struct timespec* deadline)
+{
+    if(!channel_list || !completed || !completed_count || max_completed == 0){
+        return GEN_ERROR;
+    }
+    *completed_count = 0;
+    // Left past the end of the list by errors that are not caused by an entry
+    size_t first = channel_count;
+    enum channel_status status = channel_select_until(channel_list, channel_count, &first, 0, deadline, CHANNEL_SITE_SELECT);
+    if(status != SUCCESS){
+        if(status == CLOSED_ERROR || status == GEN_ERROR){
+            completed[0] = first;
+        }
+        CHANNEL_TRACE_EVENT(status == CLOSED_ERROR ? channel_list[first].channel : NULL, CHANNEL_TRACE_SELECT, status);
+        return status;
+    }
+    completed[(*completed_count)++] = first;
+    CHANNEL_TRACE_EVENT(channel_list[first].channel, CHANNEL_TRACE_SELECT, status);
+
+    // The caller is already awake, so take whatever else is ready without waiting again
+    // An error ends the pass; the operations already performed must still be reported
+    for(size_t k = 1; k < channel_count && *completed_count < max_completed; k++){
+        size_t i = first + k < channel_count ? first + k : first + k - channel_count;
+        enum channel_status next = select_attempt(&channel_list[i], NULL, CHANNEL_SITE_SELECT);
+        if(next == SUCCESS){
+            completed[(*completed_count)++] = i;
+            CHANNEL_TRACE_EVENT(channel_list[i].channel, CHANNEL_TRACE_SELECT, next);
+        } else if(next != CHANNEL_EMPTY){
+            break;
+        }
+    }
+    return SUCCESS;
+}
+
+// Sets fairness to the given order with the scan starting at the first entry and a seeded generator
+void channel_select_fairness_init(channel_select_fairness_t* fairness, enum channel_select_order order)
+{
+    fairness->order = order;
+    fairness->next = 0;
+
+    // Seed from the time and the address so that selects started together do not pick alike
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t seed = (uint64_t)now.tv_nsec ^ ((uint64_t)now.tv_sec << 32) ^ (uint64_t)(uintptr_t)fairness;
+    seed = (seed ^ (seed >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    seed = (seed ^ (seed >> 27)) * UINT64_C(0x94D049BB133111EB);
+    fairness->random = seed ^ (seed >> 31);
+    if(fairness->random == 0){
+        fairness->random = 1;
+    }
+}
+
+// Returns the index the next scan of a list of channel_count entries starts at
+static size_t channel_select_start(channel_select_fairness_t* fairness, size_t channel_count)
+{
+    if(channel_count == 0){
+        return 0;
+    }
+    switch(fairness->order){
+    case CHANNEL_SELECT_ROUND_ROBIN:
+        return fairness->next % channel_count;
+    case CHANNEL_SELECT_RANDOM: {
+        // xorshift64*
+        uint64_t x = fairness->random;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        fairness->random = x;
+        return (size_t)((x * UINT64_C(0x2545F4914F6CDD1D)) % channel_count);
+    }
+    default:
+        return 0;
+    }
+}
+
+// Same as channel_select_timed, but picks among the operations that can be performed in the order set in fairness
+// Returns GEN_ERROR if fairness is NULL
+enum channel_status channel_select_fair(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                        channel_select_fairness_t* fairness, const struct timespec* deadline)
+{
+    if(!fairness){
+        return GEN_ERROR;
+    }
+    size_t start = channel_select_start(fairness, channel_count);
+    enum channel_status status = channel_select_until(channel_list, channel_count, selected_index, start, deadline,
+                                                      CHANNEL_SITE_SELECT);
+    if(status == SUCCESS){
+        fairness->next = *selected_index + 1;
+    }
+    CHANNEL_TRACE_EVENT(status == SUCCESS || status == CLOSED_ERROR ? channel_list[*selected_index].channel : NULL,
+                        CHANNEL_TRACE_SELECT, status);
+    return status;
+}
+
+// Creates an empty select set
+select_set_t* select_set_create(void)
+{
+    select_set_t* set = (select_set_t*)malloc(sizeof(select_set_t));
+    if(!set){
+        return NULL;
+    }
+    select_waiter_init(&set->waiter, true);
+    set->entries = NULL;
+    set->capacity = 0;
+    return set;
+}
+
+// Adds an operation to the set, enabled, and registers the set's waiter on its channel
+// Returns SUCCESS with id set to the entry's id, or GEN_ERROR
+enum channel_status select_set_add(select_set_t* set, channel_t* channel, enum direction dir, void* data, size_t* id)
+{
+    if(!set || !channel || !id || (dir != SEND && dir != RECV) || !channel_allows(channel, dir) ||
+       (channel_is_typed(channel) && !data)){
+        return GEN_ERROR;
+    }
+    // Reuse the slot of a removed entry before growing the table
+    size_t slot = 0;
+    while(slot < set->capacity && set->entries[slot]){
+        slot++;
+    }
+    if(slot == set->capacity){
+        size_t capacity = set->capacity ? set->capacity * 2 : 8;
+        select_set_entry_t** entries = (select_set_entry_t**)realloc(set->entries, sizeof(select_set_entry_t*) * capacity);
+        if(!entries){
+            return GEN_ERROR;
+        }
+        for(size_t i = set->capacity; i < capacity; i++){
+            entries[i] = NULL;
+        }
+        set->entries = entries;
+        set->capacity = capacity;
+    }
+    select_set_entry_t* entry = (select_set_entry_t*)malloc(sizeof(select_set_entry_t));
+    if(!entry){
+        return GEN_ERROR;
+    }
+    entry->op.channel = channel;
+    entry->op.dir = dir;
+    entry->op.data = data;
+    entry->registration.waiter = &set->waiter;
+    entry->registration.entry = &entry->op;
+    entry->registration.index = slot;
+    entry->registration.enabled = true;
+    atomic_init(&entry->registration.pending, false);
+    entry->registration.handed = false;
+    select_link(channel, &entry->registration, CHANNEL_SITE_SELECT);
+    set->entries[slot] = entry;
+    *id = slot;
+    return SUCCESS;
+}
+
+// Returns the entry of the set with the given id, or NULL if there is none
+static inline select_set_entry_t* select_set_find(select_set_t* set, size_t id)
+{
+    return set && id < set->capacity ? set->entries[id] : NULL;
+}
+
+// Removes an operation from the set and unregisters the set's waiter from its channel
+// Returns SUCCESS, or GEN_ERROR if there is no entry with that id
+enum channel_status select_set_remove(select_set_t* set, size_t id)
+{
+    select_set_entry_t* entry = select_set_find(set, id);
+    if(!entry){
+        return GEN_ERROR;
+    }
+    select_unlink(entry->op.channel, &entry->registration, CHANNEL_SITE_SELECT);
+    set->entries[id] = NULL;
+    free(entry);
+    return SUCCESS;
+}
+
+// Makes channel_select_set consider (enabled true) or skip an entry
+// Returns SUCCESS, or GEN_ERROR if there is no entry with that id
+static enum channel_status select_set_toggle(select_set_t* set, size_t id, bool enabled)
+{
+    select_set_entry_t* entry = select_set_find(set, id);
+    if(!entry){
+        return GEN_ERROR;
+    }
+    entry->registration.enabled = enabled;
     return SUCCESS;
 }
+
+// Makes channel_select_set consider the entry again
+enum channel_status select_set_enable(select_set_t* set, size_t id)
+{
+    return select_set_toggle(set, id, true);
+}
+
+// Makes channel_select_set skip the entry until it is enabled again
+enum channel_status select_set_disable(select_set_t* set, size_t id)
+{
+    return select_set_toggle(set, id, false);
+}
+
+// Returns the operation of the entry, or NULL if there is no entry with that id
+select_t* select_set_entry(select_set_t* set, size_t id)
+{
+    select_set_entry_t* entry = select_set_find(set, id);
+    return entry ? &entry->op : NULL;
+}
+
+// Unregisters the set from all channels and frees it
+void select_set_destroy(select_set_t* set)
+{
+    if(!set){
+        return;
+    }
+    for(size_t id = 0; id < set->capacity; id++){
+        if(set->entries[id]){
+            select_set_remove(set, id);
+        }
+    }
+    free(set->entries);
+    select_waiter_destroy(&set->waiter);
+    free(set);
+}
+
+// Performs the first enabled operation of the set that can complete without blocking
+// Returns CHANNEL_EMPTY if none of them can, like select_try
+static enum channel_status select_set_try(select_set_t* set, size_t* selected_id, select_waiter_t* self)
+{
+    for(size_t id = 0; id < set->capacity; id++){
+        select_set_entry_t* entry = set->entries[id];
+        if(!entry || !entry->registration.enabled){
+            continue;
+        }
+        enum channel_status status = select_attempt(&entry->op, self, CHANNEL_SITE_SELECT);
+        if(status != CHANNEL_EMPTY){
+            *selected_id = id;
+            return status;
+        }
+    }
+    return select_decided(self, selected_id);
+}
+
+// Counts (waiting true) or uncounts the enabled entries of the set as waiting selects
+static void select_set_count_waiting(select_set_t* set, bool waiting)
+{
+    for(size_t id = 0; id < set->capacity; id++){
+        select_set_entry_t* entry = set->entries[id];
+        if(entry && entry->registration.enabled){
+            select_count_waiting(entry->op.channel, &entry->registration, waiting);
+        }
+    }
+}
+
+// Takes the events handed to the enabled entries of a set whose select woke up
+static void select_set_take(select_set_t* set)
+{
+    for(size_t id = 0; id < set->capacity; id++){
+        select_set_entry_t* entry = set->entries[id];
+        if(entry && entry->registration.enabled){
+            select_registration_take(&entry->registration);
+        }
+    }
+}
+
+// Passes on the events the enabled entries of a set that went idle did not use (see
+// select_registration_pass_on); selected_id is the entry performed, if any
+// A send or receive that saw the waiter armed hands out its event under MutexLock, so the lock
+// of each channel is taken once first to wait for any that is still at it
+static void select_set_pass_on(select_set_t* set, bool performed, size_t selected_id)
+{
+    for(size_t id = 0; id < set->capacity; id++){
+        select_set_entry_t* entry = set->entries[id];
+        if(entry && entry->registration.enabled){
+            channel_lock(entry->op.channel, CHANNEL_SITE_SELECT);
+            channel_unlock(entry->op.channel, CHANNEL_SITE_SELECT);
+            select_registration_pass_on(&entry->registration, performed && id == selected_id, CHANNEL_SITE_SELECT);
+        }
+    }
+}
+
+// Performs one of the enabled operations of the set like channel_select_timed
+// Returns SUCCESS, TIMEOUT, CLOSED_ERROR or GEN_ERROR with selected_id set to the entry's id
+enum channel_status channel_select_set(select_set_t* set, size_t* selected_id, const struct timespec* deadline)
+{
+    if(!set || !selected_id){
+        return GEN_ERROR;
+    }
+
+    // Fast path: the waiter stays done, so a rendezvous cannot complete the set meanwhile
+    enum channel_status status = select_set_try(set, selected_id, NULL);
+    if(status == CHANNEL_EMPTY){
+        // Slow path: the waiter is already registered, it only has to be armed and counted
+        // The waiter stops being idle before it is counted, so a send or receive that sees the
+        // count also sees it armed
+        pthread_mutex_lock(&set->waiter.lock);
+        set->waiter.done = false;
+        set->waiter.notified = false;
+        pthread_mutex_unlock(&set->waiter.lock);
+        atomic_store(&set->waiter.idle, false);
+        select_set_count_waiting(set, true);
+        CHANNEL_TRACE_EVENT(NULL, CHANNEL_TRACE_SELECT_PARK, 0);
+        CHANNEL_PROBE(select_park, set, set->capacity);
+#if CHANNEL_PROBES
+        uint64_t parked_at = CHANNEL_PROBE_ENABLED(select_unpark) ? channel_stat_now() : 0;
+#endif
+        while((status = select_set_try(set, selected_id, &set->waiter)) == CHANNEL_EMPTY){
+            if(select_waiter_wait(&set->waiter, deadline)){
+                status = TIMEOUT;
+                break;
+            }
+            select_set_take(set);
+        }
+        // Every way out of the loop left the waiter done: a performed operation, an error
+        // (see select_fail), a rendezvous and a timeout all set it
+        CHANNEL_TRACE_EVENT(NULL, CHANNEL_TRACE_UNPARK, status);
+        CHANNEL_PROBE(select_unpark, set, set->capacity, parked_at ? channel_stat_now() - parked_at : 0, status);
+        select_set_count_waiting(set, false);
+        atomic_store(&set->waiter.idle, true);
+        select_set_pass_on(set, status == SUCCESS, *selected_id);
+    }
+    CHANNEL_TRACE_EVENT(status == SUCCESS || status == CLOSED_ERROR ? set->entries[*selected_id]->op.channel : NULL,
+                        CHANNEL_TRACE_SELECT, status);
+    return status;
+}
@@ -9,6 +9,9 @@
 #include <stddef.h> 
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <stdint.h>
 #include "linked_list.h"
 
 // Defines possible return values from channel functions
@@ -18,22 +21,185 @@ enum channel_status {
     SUCCESS = 1,
     CLOSED_ERROR = -2,
     GEN_ERROR = -1,
-    DESTROY_ERROR = -3
+    DESTROY_ERROR = -3,
+    TIMEOUT = -4
 };
 
-// Defines channel object
+// Defines how many threads may use each end of a channel
+// CHANNEL_MPMC allows any number of senders and receivers
+// CHANNEL_SPSC requires that only one thread ever sends and only one thread ever receives
+// CHANNEL_MPSC allows any number of senders but only one thread may ever receive (directly or through select)
+// CHANNEL_BROADCAST allows any number of senders, and every value sent reaches every subscription
+// (see channel_create_broadcast); nothing can be received from the broadcast channel itself
+// CHANNEL_SUBSCRIPTION is the kind of the channels channel_subscribe returns, which can only be
+// received from; channel_create_attr does not create them
+// CHANNEL_CONFLATING allows any number of senders and receivers and only keeps the latest value
+// (see channel_create_conflating)
+// CHANNEL_LOSSY allows any number of senders and receivers and drops the oldest value instead
+// of waiting when the buffer is full (see channel_create_lossy)
+// CHANNEL_TYPED allows any number of senders and receivers and copies values of a fixed size
+// into its buffer instead of passing pointers (see channel_create_typed)
+enum channel_kind {
+    CHANNEL_MPMC,
+    CHANNEL_SPSC,
+    CHANNEL_MPSC,
+    CHANNEL_BROADCAST,
+    CHANNEL_SUBSCRIPTION,
+    CHANNEL_CONFLATING,
+    CHANNEL_LOSSY,
+    CHANNEL_TYPED,
+};
+
+// Defines what a blocking send or receive on a buffered channel does while the buffer is full (empty)
+// CHANNEL_WAIT_BLOCK parks the thread right away; it is the default, spinning is opted into with
+// channel_attr_t
+// CHANNEL_WAIT_SPIN keeps spinning and yielding until the operation completes and never parks;
+// only use it when the threads on both ends have a core to themselves
+// CHANNEL_WAIT_HYBRID spins for a fixed number of checks, then yields a few times, then parks
+// CHANNEL_WAIT_ADAPTIVE works like CHANNEL_WAIT_HYBRID but grows the spin budget of the channel
+// when spinning pays off and shrinks it when the thread ends up parking anyway
+// No spinning is done on a machine with a single cpu, where only yielding can help
+enum channel_wait_policy {
+    CHANNEL_WAIT_BLOCK,
+    CHANNEL_WAIT_ADAPTIVE,
+    CHANNEL_WAIT_SPIN,
+    CHANNEL_WAIT_HYBRID,
+};
+
+// Defines the options of channel_create_attr
+// Initialize with channel_attr_init so that options added later keep their defaults
+typedef struct {
+    enum channel_kind kind;
+    enum channel_wait_policy wait_policy;
+    // Name the channel is exported under by the registry (see channel_registry.h), or NULL
+    const char* name;
+    // Records how long each value sits in the buffer (see channel_get_latency)
+    bool record_latency;
+    // Size in bytes of the values of a CHANNEL_TYPED channel, ignored for the other kinds
+    size_t elem_size;
+} channel_attr_t;
+
+// Defines the sojourn times (from the send that added a value to the buffer to the
+// receive that removed it) reported by channel_get_latency
+typedef struct {
+    uint64_t count;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+} channel_latency_t;
+
+// Defines the call sites that take the MutexLock of a channel, used to index channel_stats_t.locks
+// Blocking sends and receives on an unbuffered channel count as CHANNEL_SITE_SEND/CHANNEL_SITE_RECEIVE
+// although they wait like a select with a single entry
+enum channel_lock_site {
+    CHANNEL_SITE_SEND,
+    CHANNEL_SITE_RECEIVE,
+    CHANNEL_SITE_NON_BLOCKING,
+    CHANNEL_SITE_CLOSE,
+    CHANNEL_SITE_SELECT,
+    CHANNEL_SITES
+};
+
+// Defines the MutexLock profile of one call site
+// Every acquisition first tries the lock; only the ones that found it taken count as contended
+// and add the time until they got it to wait_ns
+typedef struct {
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_ns;
+    uint64_t hold_ns;
+} channel_lock_stats_t;
+
+// Defines the counters reported by channel_get_stats
+// Counting is only compiled in when CHANNEL_STATS is defined (make STATS=1, or the debug target)
 typedef struct {
+    // Values that went through the channel
+    uint64_t sends;
+    uint64_t receives;
+    // Non-blocking calls that returned CHANNEL_FULL/CHANNEL_EMPTY
+    uint64_t send_full;
+    uint64_t receive_empty;
+    // Blocking sends/receives that had to sleep, and the total time they slept
+    uint64_t send_parks;
+    uint64_t receive_parks;
+    uint64_t parked_ns;
+    // Threads and selects woken by a send/receive/close, and wakeups after which the woken thread found work
+    uint64_t wakeups;
+    uint64_t wakeups_with_work;
+    // Highest number of values seen in the buffer
+    size_t peak_size;
+    // MutexLock acquisitions by call site
+    channel_lock_stats_t locks[CHANNEL_SITES];
+} channel_stats_t;
+
+// Defines channel object
+typedef struct channel {
     // DO NOT REMOVE buffer (OR CHANGE ITS NAME) FROM THE STRUCT
     // YOU MUST USE buffer TO STORE YOUR BUFFERED CHANNEL MESSAGES
     buffer_t* buffer;
 
     /* ADD ANY STRUCT ENTRIES YOU NEED HERE */
     /* IMPLEMENT THIS */
+    // MutexLock protects the select registrations and the unbuffered rendezvous;
+    // send and receive go straight to the lock-free buffer and park on the futex words below
     pthread_mutex_t MutexLock;
-    pthread_cond_t read;
-    pthread_cond_t write;
     void* data;
-    unsigned long int closed;
+    atomic_ulong closed;
+
+    // Futex words that blocked senders/receivers sleep on
+    // Each is bumped whenever a value is removed/added (and on close) before waking sleepers
+    atomic_uint send_futex;
+    atomic_uint recv_futex;
+
+    // Number of senders/receivers sleeping (or about to sleep) on send_futex/recv_futex
+    // Fast-path operations only make the FUTEX_WAKE system call when these are non-zero
+    atomic_size_t send_waiters;
+    atomic_size_t recv_waiters;
+
+    // Registrations of blocked channel_select calls, protected by MutexLock, and the
+    // number of them for each direction
+    // Fast-path operations only take MutexLock to notify selects when these are non-zero
+    list_t* selectors;
+    atomic_size_t send_selects;
+    atomic_size_t recv_selects;
+
+    // Selects the buffer functions used by send and receive
+    enum channel_kind kind;
+
+    // How blocking send/receive wait before parking, and the current spin budget
+    // (number of buffer checks) of an adaptive channel
+    enum channel_wait_policy wait_policy;
+    atomic_uint spin_budget;
+    unsigned spin_max;
+
+    // Sojourn times of the values, if the channel records them
+    histogram_t* latency;
+
+    // State shared by a broadcast channel and its subscriptions, NULL for other kinds, and the
+    // position in the broadcast channel's buffer of the next value a subscription receives
+    // A subscription's buffer is the buffer of its broadcast channel
+    struct channel_broadcast* broadcast;
+    atomic_size_t cursor;
+
+    // Values of a conflating (lossy) channel that were replaced by a newer value (dropped to
+    // make room for one) before anyone received them
+    atomic_uint_fast64_t dropped;
+
+    // Name and links of the channel in the process-wide registry, protected by its lock,
+    // and the number the registry gave the channel (never 0, identifies it in traces)
+    char* name;
+    uint32_t id;
+    struct channel* registry_prev;
+    struct channel* registry_next;
+
+#ifdef CHANNEL_STATS
+    // Counters behind channel_get_stats, sharded by thread so that threads do not
+    // contend on one cache line
+    struct channel_stats_shard* stats;
+    // When the current holder of MutexLock acquired it, protected by MutexLock
+    uint64_t lock_acquired_ns;
+#endif
 } channel_t;
 
 // Defines channel list structure for channel_select function
@@ -48,13 +214,80 @@ typedef struct {
     enum direction dir;
     // If dir is RECV, then the message received from the channel is stored as an output in this parameter, data
     // If dir is SEND, then the message that needs to be sent is given as input in this parameter, data
+    // On a typed channel data is the address of the value in both directions: a SEND copies the
+    // value from it and a RECV copies the received value to it
     void* data;
 } select_t;
 
 // Creates a new channel with the provided size and returns it to the caller
 // A 0 size indicates an unbuffered channel, whereas a positive size indicates a buffered channel
+// Returns NULL if the channel cannot be allocated
 channel_t* channel_create(size_t size);
 
+// Creates a new single-producer/single-consumer channel with the provided size and returns it to the caller
+// The channel behaves like one from channel_create, but the caller guarantees that at most one thread
+// ever sends on it and at most one thread ever receives from it, which lets the buffer skip all
+// read-modify-write operations on its indices
+channel_t* channel_create_spsc(size_t size);
+
+// Creates a new multi-producer/single-consumer channel with the provided size and returns it to the caller
+// Any number of threads may send, but the caller guarantees that only one thread ever receives from it
+// Sends never retry against each other and the receiver never takes a lock unless it has to wait
+channel_t* channel_create_mpsc(size_t size);
+
+// Creates a new broadcast channel with the provided size and returns it to the caller
+// Every value sent on it is stored once in its buffer and received by every subscription (see
+// channel_subscribe) that was open when it was sent, each at its own pace; a send waits while the
+// slowest subscription still has size values to receive, and a value sent while there is no
+// subscription reaches no one
+// Values can be sent with every send function and with select SEND; nothing can be received from
+// the channel itself (GEN_ERROR)
+// Closing it closes all of its subscriptions
+// Returns NULL for a 0 size
+channel_t* channel_create_broadcast(size_t size);
+
+// Subscribes to a broadcast channel and returns the subscription, a channel that receives every
+// value sent on the broadcast channel from now on and works with every receive function and with
+// select RECV; nothing can be sent on it (GEN_ERROR)
+// Only one thread at a time may receive from a subscription
+// Closing the subscription unsubscribes it, so it no longer holds back the senders; a subscription
+// must be closed and destroyed like any other channel, before or after the broadcast channel
+// Returns NULL if broadcast is not an open broadcast channel
+channel_t* channel_subscribe(channel_t* broadcast);
+
+// Creates a new conflating channel and returns it to the caller
+// Its buffer holds only the latest value: a send never waits, it replaces the value that is
+// still in the buffer (counted by channel_get_superseded), and a receive takes the most recent
+// value sent, or waits for the next one if it was already received
+// channel_create_attr ignores the size of a CHANNEL_CONFLATING channel
+channel_t* channel_create_conflating(void);
+
+// Creates a new lossy channel with the provided size and returns it to the caller
+// A send never waits: while the buffer is full it drops the oldest value to make room (counted
+// by channel_get_dropped); receives work as on a channel from channel_create, and a value is
+// either received exactly once or dropped
+// Returns NULL for a 0 size
+channel_t* channel_create_lossy(size_t size);
+
+// Creates a new typed channel for values of elem_size bytes with the provided capacity and
+// returns it to the caller
+// Each value is copied into a slot of the buffer that starts on its own cache line, so sending a
+// small struct needs no allocation for it and receiving it no pointer chase
+// Values are sent and received with the *_value functions and with select, where the data of
+// the entry is the address of the value; the functions that pass void* values return GEN_ERROR
+// Returns NULL for a 0 capacity or elem_size
+channel_t* channel_create_typed(size_t capacity, size_t elem_size);
+
+// Sets attr to the defaults used by channel_create: an unnamed multi-producer/multi-consumer
+// channel with the CHANNEL_WAIT_BLOCK wait policy that does not record latency
+void channel_attr_init(channel_attr_t* attr);
+
+// Creates a new channel with the provided size and options and returns it to the caller
+// A NULL attr is the same as one set by channel_attr_init
+// Returns NULL for options that are not valid (see the channel_create_* functions), or if the
+// channel cannot be allocated
+channel_t* channel_create_attr(size_t size, const channel_attr_t* attr);
+
 // Writes data to the given channel
 // This is a blocking call i.e., the function only returns on a successful completion of send
 // In case the channel is full, the function waits till the channel has space to write the new data
@@ -87,6 +320,76 @@ enum channel_status channel_non_blocking_send(channel_t* channel, void* data);
 // GEN_ERROR on encountering any other generic error of any sort
 enum channel_status channel_non_blocking_receive(channel_t* channel, void** data);
 
+// Writes the n values of items to the given channel in order
+// As many values as fit are added to the buffer at once with a single wakeup for the receivers
+// This is a blocking call i.e., the function only returns once all values were written or the channel is closed
+// Returns SUCCESS once all n values were written,
+// CLOSED_ERROR if the channel is closed before that, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case sent (if not NULL) is set to the number of values that were written
+enum channel_status channel_send_many(channel_t* channel, void** items, size_t n, size_t* sent);
+
+// Reads up to max values from the given channel into out, in the order they were sent
+// This is a blocking call i.e., the function waits till the channel has at least one value to read
+// and then takes as many of the available values as fit into out
+// Returns SUCCESS once at least one value was read (or max is 0),
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case got (if not NULL) is set to the number of values that were read
+enum channel_status channel_receive_many(channel_t* channel, void** out, size_t max, size_t* got);
+
+// Writes as many of the n values of items to the given channel as it can without waiting
+// Returns SUCCESS if at least one value was written (all n if n is 0),
+// CHANNEL_FULL if the channel is full and nothing was written,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case sent (if not NULL) is set to the number of values that were written
+enum channel_status channel_non_blocking_send_many(channel_t* channel, void** items, size_t n, size_t* sent);
+
+// Reads as many values (up to max) from the given channel into out as it can without waiting
+// Returns SUCCESS if at least one value was read (or max is 0),
+// CHANNEL_EMPTY if the channel is empty and nothing was read,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+// In every case got (if not NULL) is set to the number of values that were read
+enum channel_status channel_non_blocking_receive_many(channel_t* channel, void** out, size_t max, size_t* got);
+
+// Writes data to the given channel, waiting for space until the deadline at the latest
+// deadline is an absolute time on CLOCK_MONOTONIC (see clock_gettime); a NULL deadline waits forever
+// Returns SUCCESS for successfully writing data to the channel,
+// TIMEOUT if the deadline passed before the data could be written,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_send_timed(channel_t* channel, void* data, const struct timespec* deadline);
+
+// Reads data from the given channel, waiting for data until the deadline at the latest
+// deadline is an absolute time on CLOCK_MONOTONIC (see clock_gettime); a NULL deadline waits forever
+// Returns SUCCESS for successful retrieval of data,
+// TIMEOUT if the deadline passed before any data arrived,
+// CLOSED_ERROR if the channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_receive_timed(channel_t* channel, void** data, const struct timespec* deadline);
+
+// Copies the elem_size bytes at value into the given typed channel
+// Blocks like channel_send while the channel is full; value may be reused as soon as it returns
+// Returns SUCCESS, CLOSED_ERROR, or GEN_ERROR if the channel is not typed or value is NULL
+enum channel_status channel_send_value(channel_t* channel, const void* value);
+
+// Copies the oldest value of the given typed channel to the elem_size bytes at value
+// Blocks like channel_receive while the channel is empty
+// Returns SUCCESS, CLOSED_ERROR, or GEN_ERROR if the channel is not typed or value is NULL
+enum channel_status channel_receive_value(channel_t* channel, void* value);
+
+// Same as channel_send_value (channel_receive_value), but never waits, like
+// channel_non_blocking_send (channel_non_blocking_receive)
+enum channel_status channel_non_blocking_send_value(channel_t* channel, const void* value);
+enum channel_status channel_non_blocking_receive_value(channel_t* channel, void* value);
+
+// Same as channel_send_value (channel_receive_value), but waits until the deadline at the latest,
+// like channel_send_timed (channel_receive_timed)
+enum channel_status channel_send_value_timed(channel_t* channel, const void* value, const struct timespec* deadline);
+enum channel_status channel_receive_value_timed(channel_t* channel, void* value, const struct timespec* deadline);
+
 // Closes the channel and informs all the blocking send/receive/select calls to return with CLOSED_ERROR
 // Once the channel is closed, send/receive/select operations will cease to function and just return CLOSED_ERROR
 // Returns SUCCESS if close is successful,
@@ -101,6 +404,28 @@ enum channel_status channel_close(channel_t* channel);
 // GEN_ERROR in any other error case
 enum channel_status channel_destroy(channel_t* channel);
 
+// Stores a snapshot of the channel's counters in stats
+// The counters of concurrent operations may or may not be included
+// Returns SUCCESS if the snapshot was taken, and
+// GEN_ERROR if the channel was built without CHANNEL_STATS or on any other error
+enum channel_status channel_get_stats(channel_t* channel, channel_stats_t* stats);
+
+// Stores the sojourn time percentiles of the values that went through the channel's buffer in latency
+// Only channels created with record_latency set record them, and values handed over directly
+// on an unbuffered channel never sit in a buffer
+// Returns SUCCESS if the percentiles were stored, and
+// GEN_ERROR if the channel does not record latency or on any other error
+enum channel_status channel_get_latency(channel_t* channel, channel_latency_t* latency);
+
+// Stores the number of values a conflating channel dropped because a newer one was sent before
+// they were received in superseded
+// Returns SUCCESS, or GEN_ERROR if the channel is not a conflating channel
+enum channel_status channel_get_superseded(channel_t* channel, uint64_t* superseded);
+
+// Stores the number of values a lossy channel dropped to make room for newer ones in dropped
+// Returns SUCCESS, or GEN_ERROR if the channel is not a lossy channel
+enum channel_status channel_get_dropped(channel_t* channel, uint64_t* dropped);
+
 // Takes an array of channels, channel_list, of type select_t and the array length, channel_count, as inputs
 // This API iterates over the provided list and finds the set of possible channels which can be used to invoke the required operation (send or receive) specified in select_t
 // If multiple options are available, it selects the first option and performs its corresponding action
@@ -108,6 +433,123 @@ enum channel_status channel_destroy(channel_t* channel);
 // Once an operation has been successfully performed, select should set selected_index to the index of the channel that performed the operation and then return SUCCESS
 // In the event that a channel is closed or encounters any error, the error should be propagated and returned through select
 // Additionally, selected_index is set to the index of the channel that generated the error
+// An empty list (channel_count 0) could never be woken, so it returns GEN_ERROR right away
 enum channel_status channel_select(select_t* channel_list, size_t channel_count, size_t* selected_index);
 
+// Same as channel_select, but never waits: makes one pass over the list and performs the first
+// operation that can complete right away, like a Go select with a default case
+// Buffered entries are tried without taking any lock; an unbuffered entry only succeeds if a
+// counterpart is already blocked on the channel
+// Returns SUCCESS with selected_index set to the entry performed,
+// CHANNEL_EMPTY if none of the operations could be performed right now,
+// CLOSED_ERROR (GEN_ERROR) if the pass reached an entry whose channel is closed (invalid) before
+// finding a ready one, with selected_index set to that entry
+enum channel_status channel_select_non_blocking(select_t* channel_list, size_t channel_count, size_t* selected_index);
+
+// Same as channel_select, but waits until the deadline at the latest
+// deadline is an absolute time on CLOCK_MONOTONIC (see clock_gettime); a NULL deadline waits forever
+// Returns TIMEOUT if the deadline passed before any of the operations could be performed
+enum channel_status channel_select_timed(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                         const struct timespec* deadline);
+
+// Same as channel_select_timed, but once an operation has been performed keeps performing the
+// other operations of the list that can complete right away, up to max_completed in total, so a
+// select that wakes up handles everything that became ready meanwhile in one call
+// After the first operation the list is passed over once, starting after it and wrapping around;
+// each entry is performed at most once per call, so list an entry several times to take several
+// values from the same channel
+// Returns SUCCESS with the indices of the entries performed in completed[0..*completed_count),
+// in the order they were performed,
+// TIMEOUT with *completed_count 0 if the deadline passed before any operation could be performed,
+// CLOSED_ERROR (GEN_ERROR) with *completed_count 0 and completed[0] set to the entry if its channel
+// is closed (invalid) before any operation was performed; an entry whose channel is found closed
+// after that ends the pass and is reported by the next call, and
+// GEN_ERROR if an argument is NULL, the list is empty or max_completed is 0
+enum channel_status channel_select_ready(select_t* channel_list, size_t channel_count, size_t* completed,
+                                         size_t max_completed, size_t* completed_count,
+                                         const struct timespec* deadline);
+
+// Defines where channel_select_fair starts looking for an operation that can be performed
+// CHANNEL_SELECT_FIRST_READY starts at the first entry like channel_select, so busy entries at low
+// indices can keep the later ones from ever being selected
+// CHANNEL_SELECT_ROUND_ROBIN starts right after the entry selected by the previous call, so an
+// entry that stays ready is passed over at most channel_count - 1 times in a row
+// CHANNEL_SELECT_RANDOM starts at a random entry
+enum channel_select_order {
+    CHANNEL_SELECT_FIRST_READY,
+    CHANNEL_SELECT_ROUND_ROBIN,
+    CHANNEL_SELECT_RANDOM,
+};
+
+// Defines the state a caller keeps between calls of channel_select_fair
+// Initialize with channel_select_fairness_init; it must not be used by two threads at once
+typedef struct {
+    enum channel_select_order order;
+    // Entry the next round-robin scan starts at
+    size_t next;
+    // State of the random number generator
+    uint64_t random;
+} channel_select_fairness_t;
+
+// Sets fairness to the given order with the scan starting at the first entry and a seeded generator
+void channel_select_fairness_init(channel_select_fairness_t* fairness, enum channel_select_order order);
+
+// Same as channel_select_timed, but picks among the operations that can be performed in the order
+// set in fairness (see enum channel_select_order) instead of always taking the first one
+// Use the same fairness for every call on the same list
+// Returns GEN_ERROR if fairness is NULL
+enum channel_status channel_select_fair(select_t* channel_list, size_t channel_count, size_t* selected_index,
+                                        channel_select_fairness_t* fairness, const struct timespec* deadline);
+
+// Defines a prepared select: a set of operations whose waiter stays registered on their channels
+// between selects, so a select on the set that has to wait only arms the waiter instead of
+// allocating and registering it on every channel and unregistering it afterwards
+// Between selects the set is idle: sends and receives on its channels skip it and only take
+// MutexLock to notify selects while the set (or another select) is blocked
+// Entries are identified by the id select_set_add returns, which stays the same until the entry
+// is removed (the id of a removed entry may be given to a later one)
+// A set must only be used by one thread at a time, and its entries must be removed (or the set
+// destroyed) before their channels are destroyed
+typedef struct select_set select_set_t;
+
+// Creates an empty select set
+// Returns NULL if it could not be allocated
+select_set_t* select_set_create(void);
+
+// Adds the operation dir on channel with data to the set, enabled, and registers the set on the channel
+// Returns SUCCESS with id set to the id of the new entry, or
+// GEN_ERROR if an argument is NULL (data may only be NULL for a channel that is not typed), the
+// channel does not have direction dir (see channel_create_broadcast) or the entry could not be allocated
+enum channel_status select_set_add(select_set_t* set, channel_t* channel, enum direction dir, void* data, size_t* id);
+
+// Removes the entry from the set and unregisters the set from its channel
+// Returns SUCCESS, or GEN_ERROR if the set has no entry with that id
+enum channel_status select_set_remove(select_set_t* set, size_t id);
+
+// Makes channel_select_set consider the entry again after select_set_disable
+// Cheap: the entry stays registered on its channel
+// Returns SUCCESS, or GEN_ERROR if the set has no entry with that id
+enum channel_status select_set_enable(select_set_t* set, size_t id);
+
+// Makes channel_select_set skip the entry until it is enabled again
+// Returns SUCCESS, or GEN_ERROR if the set has no entry with that id
+enum channel_status select_set_disable(select_set_t* set, size_t id);
+
+// Returns the operation of the entry, or NULL if the set has no entry with that id
+// Set data through it before a select to change the value a SEND entry sends; after a select
+// that performed a RECV entry its data holds the received value
+select_t* select_set_entry(select_set_t* set, size_t id);
+
+// Unregisters the set from all channels and frees it
+void select_set_destroy(select_set_t* set);
+
+// Performs one of the enabled operations of the set like channel_select_timed, taking the
+// first one that is ready in the order of their ids
+// deadline is an absolute time on CLOCK_MONOTONIC (see clock_gettime); a NULL deadline waits forever
+// Returns SUCCESS with selected_id set to the id of the entry performed,
+// TIMEOUT if the deadline passed before any of the operations could be performed,
+// CLOSED_ERROR with selected_id set to an entry whose channel is closed, and
+// GEN_ERROR on encountering any other generic error of any sort
+enum channel_status channel_select_set(select_set_t* set, size_t* selected_id, const struct timespec* deadline);
+
 #endif // CHANNEL_H
@@ -0,0 +1,59 @@
+#ifndef CHANNEL_PROBES_H
+#define CHANNEL_PROBES_H
+
+// Statically defined tracepoints (USDT) of channel.c under the provider "channel"
+// Built with USDT=1 (CHANNEL_USDT) where <sys/sdt.h> is installed (systemtap-sdt-dev), every
+// CHANNEL_PROBE is a single nop plus an ELF note that bpftrace and perf use to attach to it
+// while the program runs, e.g.
+//   bpftrace -e 'usdt:./channel:channel:unpark { @wait_ns = hist(arg2); }'
+// Otherwise, and with USDT=1 where <sys/sdt.h> is missing (a note says so at compile time),
+// the probes and their arguments are compiled out
+// Every probe has an is-enabled semaphore that the tracer raises while it is attached, and its
+// arguments are only computed while CHANNEL_PROBE_ENABLED(name) holds, so an unattached probe
+// costs a load and a not-taken branch; code that prepares an argument ahead of the probe (e.g. a
+// start time) checks CHANNEL_PROBE_ENABLED itself
+//
+// Probes and their arguments:
+//   send(channel, size, status)           a blocking send returned; size is the buffer occupancy after it
+//   receive(channel, size, status)        a blocking receive returned
+//   park(channel, dir, size)              a blocking send (dir SEND) or receive (RECV) goes to sleep
+//   unpark(channel, dir, wait_ns, status) it stopped sleeping after wait_ns
+//   select_park(channel_list, count)      a blocking select goes to sleep on count channels
+//   select_unpark(channel_list, count, wait_ns, status)
+//   select_notify(channel, dir)           a sleeping select was woken by an event of channel
+//   close(channel, size)                  the channel was closed with size values still in its buffer
+#ifdef CHANNEL_USDT
+#if defined(__has_include) && !__has_include(<sys/sdt.h>)
+#pragma message "USDT=1 without <sys/sdt.h> (systemtap-sdt-dev): building without channel probes"
+#else
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define CHANNEL_PROBES 1
+#endif
+#endif
+
+#ifndef CHANNEL_PROBES
+#define CHANNEL_PROBES 0
+#endif
+
+#if CHANNEL_PROBES
+// The semaphores are named after the probes as <sys/sdt.h> expects; only channel.c includes this file
+#define CHANNEL_PROBE_SEMAPHORE(name) \
+    static volatile unsigned short channel_##name##_semaphore __attribute__((used, section(".probes")))
+CHANNEL_PROBE_SEMAPHORE(send);
+CHANNEL_PROBE_SEMAPHORE(receive);
+CHANNEL_PROBE_SEMAPHORE(park);
+CHANNEL_PROBE_SEMAPHORE(unpark);
+CHANNEL_PROBE_SEMAPHORE(select_park);
+CHANNEL_PROBE_SEMAPHORE(select_unpark);
+CHANNEL_PROBE_SEMAPHORE(select_notify);
+CHANNEL_PROBE_SEMAPHORE(close);
+#define CHANNEL_PROBE_ENABLED(name) __builtin_expect(channel_##name##_semaphore != 0, 0)
+#define CHANNEL_PROBE(name, ...) \
+    do { if (CHANNEL_PROBE_ENABLED(name)) { STAP_PROBEV(channel, name, __VA_ARGS__); } } while (0)
+#else
+#define CHANNEL_PROBE_ENABLED(name) 0
+#define CHANNEL_PROBE(name, ...) ((void)0)
+#endif
+
+#endif // CHANNEL_PROBES_H
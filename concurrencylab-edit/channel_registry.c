@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "channel_registry.h"
+
+// The registry is an intrusive doubly linked list through the registry_prev/registry_next
+// fields of the channels, so adding and removing never allocates and never searches
+// registry_lock protects the list and the names of registered channels
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static channel_t* registry_head = NULL;
+static size_t registry_count = 0;
+static uint32_t registry_next_id = 1;
+
+// Adds the channel to the registry
+void channel_registry_add(channel_t* channel)
+{
+    pthread_mutex_lock(&registry_lock);
+    channel->registry_prev = NULL;
+    channel->registry_next = registry_head;
+    if (registry_head) {
+        registry_head->registry_prev = channel;
+    }
+    registry_head = channel;
+    registry_count++;
+    channel->id = registry_next_id++;
+    if (registry_next_id == 0) {
+        registry_next_id = 1;
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// Removes the channel from the registry and frees its name
+void channel_registry_remove(channel_t* channel)
+{
+    pthread_mutex_lock(&registry_lock);
+    if (channel->registry_prev) {
+        channel->registry_prev->registry_next = channel->registry_next;
+    } else {
+        registry_head = channel->registry_next;
+    }
+    if (channel->registry_next) {
+        channel->registry_next->registry_prev = channel->registry_prev;
+    }
+    registry_count--;
+    free(channel->name);
+    channel->name = NULL;
+    pthread_mutex_unlock(&registry_lock);
+}
+
+// Sets the name the channel is exported under
+enum channel_status channel_set_name(channel_t* channel, const char* name)
+{
+    if (!channel) {
+        return GEN_ERROR;
+    }
+    char* copy = NULL;
+    if (name) {
+        copy = strdup(name);
+        if (!copy) {
+            return GEN_ERROR;
+        }
+    }
+    pthread_mutex_lock(&registry_lock);
+    char* old = channel->name;
+    channel->name = copy;
+    pthread_mutex_unlock(&registry_lock);
+    free(old);
+    return SUCCESS;
+}
+
+// Returns the number of channels in the registry
+size_t channel_registry_count(void)
+{
+    pthread_mutex_lock(&registry_lock);
+    size_t count = registry_count;
+    pthread_mutex_unlock(&registry_lock);
+    return count;
+}
+
+// Writes str as the contents of a quoted Prometheus label value (json false) or JSON string
+// Both escape backslashes, quotes and newlines the same way; the Prometheus text format
+// escapes nothing else, JSON also needs the remaining control characters escaped
+static void registry_write_escaped(FILE* out, const char* str, bool json)
+{
+    for (const char* c = str; *c; c++) {
+        switch (*c) {
+        case '\\':
+            fputs("\\\\", out);
+            break;
+        case '"':
+            fputs("\\\"", out);
+            break;
+        case '\n':
+            fputs("\\n", out);
+            break;
+        default:
+            if (json && (unsigned char)*c < 0x20) {
+                fprintf(out, "\\u%04x", (unsigned)*c);
+            } else {
+                fputc(*c, out);
+            }
+        }
+    }
+}
+
+// Defines one exported field of a channel
+typedef struct {
+    const char* name;
+    const char* help;
+} registry_field_t;
+
+static const registry_field_t registry_fields[] = {
+    {"capacity", "Capacity of the channel buffer"},
+    {"size", "Number of values in the channel buffer"},
+    {"send_waiters", "Number of senders and selects waiting to send on the channel"},
+    {"recv_waiters", "Number of receivers and selects waiting to receive from the channel"},
+    {"closed", "1 if the channel is closed, 0 otherwise"},
+};
+#define REGISTRY_FIELDS (sizeof(registry_fields) / sizeof(registry_fields[0]))
+
+// The exported state of one channel, copied out of the registry so that it can be written
+// without holding registry_lock
+typedef struct {
+    uint32_t id;
+    char* name;
+    size_t values[REGISTRY_FIELDS];
+} registry_entry_t;
+
+// Reads the exported fields of a channel in the order of registry_fields
+// The values are a snapshot; the channel keeps running while they are read
+static void registry_read_fields(channel_t* channel, size_t values[REGISTRY_FIELDS])
+{
+    values[0] = buffer_capacity(channel->buffer);
+    values[1] = buffer_current_size(channel->buffer);
+    values[2] = atomic_load(&channel->send_waiters) + atomic_load(&channel->send_selects);
+    values[3] = atomic_load(&channel->recv_waiters) + atomic_load(&channel->recv_selects);
+    values[4] = atomic_load(&channel->closed) == 0;
+}
+
+// Frees the first count entries of a snapshot and the snapshot itself
+static void registry_snapshot_free(registry_entry_t* entries, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].name);
+    }
+    free(entries);
+}
+
+// Copies the id, name and fields of every registered channel, in registry order, into a new
+// array of count entries (NULL for an empty registry)
+// Returns false with nothing allocated if the copy could not be allocated
+static bool registry_snapshot(registry_entry_t** entries, size_t* count)
+{
+    pthread_mutex_lock(&registry_lock);
+    *count = registry_count;
+    *entries = NULL;
+    if (*count > 0 && !(*entries = malloc(*count * sizeof(registry_entry_t)))) {
+        pthread_mutex_unlock(&registry_lock);
+        return false;
+    }
+    size_t copied = 0;
+    for (channel_t* channel = registry_head; channel; channel = channel->registry_next, copied++) {
+        registry_entry_t* entry = &(*entries)[copied];
+        entry->id = channel->id;
+        entry->name = NULL;
+        if (channel->name && !(entry->name = strdup(channel->name))) {
+            pthread_mutex_unlock(&registry_lock);
+            registry_snapshot_free(*entries, copied);
+            return false;
+        }
+        registry_read_fields(channel, entry->values);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return true;
+}
+
+// Writes a snapshot in the Prometheus text format
+static void registry_write_prometheus(FILE* out, const registry_entry_t* entries, size_t count)
+{
+    for (size_t f = 0; f < REGISTRY_FIELDS; f++) {
+        fprintf(out, "# HELP channel_%s %s\n", registry_fields[f].name, registry_fields[f].help);
+        fprintf(out, "# TYPE channel_%s gauge\n", registry_fields[f].name);
+        for (size_t i = 0; i < count; i++) {
+            fprintf(out, "channel_%s{name=\"", registry_fields[f].name);
+            registry_write_escaped(out, entries[i].name ? entries[i].name : "", false);
+            fprintf(out, "\",id=\"%u\"} %zu\n", (unsigned)entries[i].id, entries[i].values[f]);
+        }
+    }
+}
+
+// Writes a snapshot as a JSON object
+static void registry_write_json(FILE* out, const registry_entry_t* entries, size_t count)
+{
+    fputs("{\"channels\":[", out);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(out, "%s\n{\"id\":%u,\"name\":", i == 0 ? "" : ",", (unsigned)entries[i].id);
+        if (entries[i].name) {
+            fputc('"', out);
+            registry_write_escaped(out, entries[i].name, true);
+            fputc('"', out);
+        } else {
+            fputs("null", out);
+        }
+        for (size_t f = 0; f < REGISTRY_FIELDS; f++) {
+            if (f == REGISTRY_FIELDS - 1) {
+                fprintf(out, ",\"%s\":%s", registry_fields[f].name, entries[i].values[f] ? "true" : "false");
+            } else {
+                fprintf(out, ",\"%s\":%zu", registry_fields[f].name, entries[i].values[f]);
+            }
+        }
+        fputc('}', out);
+    }
+    fputs("\n]}\n", out);
+}
+
+// Writes a snapshot of every registered channel to out and closes it
+// The snapshot is taken under registry_lock and written after releasing it, so that a slow
+// file does not hold up channel_create and channel_destroy
+static enum channel_status registry_write(FILE* out, enum channel_export_format format)
+{
+    if (!out) {
+        return GEN_ERROR;
+    }
+    registry_entry_t* entries;
+    size_t count;
+    bool failed = !registry_snapshot(&entries, &count);
+    if (!failed) {
+        if (format == CHANNEL_EXPORT_JSON) {
+            registry_write_json(out, entries, count);
+        } else {
+            registry_write_prometheus(out, entries, count);
+        }
+        registry_snapshot_free(entries, count);
+    }
+    failed = ferror(out) != 0 || failed;
+    failed = fclose(out) != 0 || failed;
+    return failed ? GEN_ERROR : SUCCESS;
+}
+
+// Writes a snapshot of every registered channel to the file descriptor fd
+enum channel_status channel_registry_export(int fd, enum channel_export_format format)
+{
+    // Write through a duplicate so that closing the stream leaves fd open
+    int copy = dup(fd);
+    if (copy < 0) {
+        return GEN_ERROR;
+    }
+    FILE* out = fdopen(copy, "w");
+    if (!out) {
+        close(copy);
+        return GEN_ERROR;
+    }
+    return registry_write(out, format);
+}
+
+// Writes a snapshot of every registered channel to the file at path
+enum channel_status channel_registry_export_path(const char* path, enum channel_export_format format)
+{
+    if (!path) {
+        return GEN_ERROR;
+    }
+    return registry_write(fopen(path, "w"), format);
+}
@@ -0,0 +1,45 @@
+#ifndef CHANNEL_REGISTRY_H
+#define CHANNEL_REGISTRY_H
+
+#include "channel.h"
+
+// Process-wide registry of live channels
+// channel_create adds every channel and channel_destroy removes it, so a snapshot of all
+// channels (capacity, current size, waiter counts and closed state) can be exported at any
+// time to find the stage of a pipeline that is backed up
+
+// Defines the formats of channel_registry_export
+// CHANNEL_EXPORT_PROMETHEUS writes the Prometheus text exposition format, one gauge per
+// field with the channel's name and id (see channel_t.id) as labels
+// CHANNEL_EXPORT_JSON writes a single object {"channels": [...]} with one object per channel
+enum channel_export_format {
+    CHANNEL_EXPORT_PROMETHEUS,
+    CHANNEL_EXPORT_JSON,
+};
+
+// Adds the channel to the registry and numbers it (see channel_t.id)
+// Called by channel_create; the channel must not already be registered
+void channel_registry_add(channel_t* channel);
+
+// Removes the channel from the registry and frees its name
+// Called by channel_destroy
+void channel_registry_remove(channel_t* channel);
+
+// Sets the name the channel is exported under; a NULL name removes it
+// The name is copied
+// Returns SUCCESS, or GEN_ERROR if the channel is NULL or the copy could not be allocated
+enum channel_status channel_set_name(channel_t* channel, const char* name);
+
+// Returns the number of channels in the registry
+size_t channel_registry_count(void);
+
+// Writes a snapshot of every registered channel to the file descriptor fd
+// The descriptor is left open
+// Returns SUCCESS, or GEN_ERROR if writing failed
+enum channel_status channel_registry_export(int fd, enum channel_export_format format);
+
+// Writes a snapshot of every registered channel to the file at path, replacing its contents
+// Returns SUCCESS, or GEN_ERROR if the file could not be written
+enum channel_status channel_registry_export_path(const char* path, enum channel_export_format format);
+
+#endif // CHANNEL_REGISTRY_H
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "channel_trace.h"
+
+// Ring of events of one thread
+// thread numbers the ring; the threads that use the ring one after another share its number
+// Only the thread that owns the ring writes its events; head counts the events ever written
+// and is published with a release store after each event, so a dump that reads head with an
+// acquire load sees every event before it complete
+typedef struct channel_trace_ring {
+    struct channel_trace_ring* next;
+    struct channel_trace_ring* next_free;
+    uint16_t thread;
+    atomic_uint_fast64_t head;
+    channel_trace_event_t events[CHANNEL_TRACE_RING_SIZE];
+} channel_trace_ring_t;
+
+// trace_lock protects the list of all rings, the list of rings of exited threads and the
+// numbering of rings; it is only taken when a thread records its first event or exits
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static channel_trace_ring_t* trace_rings = NULL;
+static channel_trace_ring_t* trace_free = NULL;
+static uint16_t trace_threads = 0;
+
+// Set once before the first ring is taken
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static uint64_t trace_start_ticks;
+static struct timespec trace_start_time;
+
+// Ring of the calling thread
+static _Thread_local channel_trace_ring_t* trace_ring = NULL;
+
+// Hands the ring of an exiting thread to the next new thread
+static void channel_trace_release(void* ring)
+{
+    pthread_mutex_lock(&trace_lock);
+    ((channel_trace_ring_t*)ring)->next_free = trace_free;
+    trace_free = (channel_trace_ring_t*)ring;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// Sets up the key whose destructor releases rings and the start of the trace clock
+static void channel_trace_init(void)
+{
+    pthread_key_create(&trace_key, channel_trace_release);
+    trace_start_ticks = histogram_now();
+    clock_gettime(CLOCK_MONOTONIC, &trace_start_time);
+}
+
+// Returns the ring of the calling thread, taking one on its first event
+// A new ring takes the next number, so numbers only run out once UINT16_MAX threads run at once
+// Returns NULL if no ring could be allocated
+static channel_trace_ring_t* channel_trace_ring(void)
+{
+    if (trace_ring) {
+        return trace_ring;
+    }
+    pthread_once(&trace_once, channel_trace_init);
+    pthread_mutex_lock(&trace_lock);
+    channel_trace_ring_t* ring = trace_free;
+    if (ring) {
+        trace_free = ring->next_free;
+    } else if (trace_threads < UINT16_MAX) {
+        ring = (channel_trace_ring_t*)malloc(sizeof(channel_trace_ring_t));
+        if (ring) {
+            ring->thread = ++trace_threads;
+            atomic_init(&ring->head, 0);
+            ring->next = trace_rings;
+            trace_rings = ring;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    if (ring) {
+        pthread_setspecific(trace_key, ring);
+    }
+    trace_ring = ring;
+    return ring;
+}
+
+// Records an event for the calling thread
+void channel_trace_record(uint32_t channel, enum channel_trace_op op, int outcome)
+{
+    channel_trace_ring_t* ring = channel_trace_ring();
+    if (!ring) {
+        return;
+    }
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    channel_trace_event_t* event = &ring->events[head & (CHANNEL_TRACE_RING_SIZE - 1)];
+    event->time = histogram_now();
+    event->channel = channel;
+    event->thread = ring->thread;
+    event->op = (uint8_t)op;
+    event->outcome = (int8_t)(outcome < INT8_MIN ? INT8_MIN : outcome > INT8_MAX ? INT8_MAX : outcome);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Returns the length of a tick of histogram_now in nanoseconds, measured since tracing started
+static double channel_trace_ns_per_tick(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t elapsed_ticks = histogram_now() - trace_start_ticks;
+    int64_t elapsed_ns = (int64_t)(now.tv_sec - trace_start_time.tv_sec) * 1000000000 +
+                         (now.tv_nsec - trace_start_time.tv_nsec);
+    if (elapsed_ticks == 0 || elapsed_ns <= 0) {
+        return 1.0;
+    }
+    return (double)elapsed_ns / (double)elapsed_ticks;
+}
+
+// Returns the number of events of a ring that are still in it, given its head
+static inline uint64_t channel_trace_kept(uint64_t head)
+{
+    return head < CHANNEL_TRACE_RING_SIZE ? head : CHANNEL_TRACE_RING_SIZE;
+}
+
+// Writes the events of all threads to out and closes it
+static enum channel_status channel_trace_write(FILE* out)
+{
+    if (!out) {
+        return GEN_ERROR;
+    }
+    pthread_once(&trace_once, channel_trace_init);
+    pthread_mutex_lock(&trace_lock);
+
+    // The heads are read once so that the header counts exactly the events written below
+    size_t rings = 0;
+    for (channel_trace_ring_t* ring = trace_rings; ring; ring = ring->next) {
+        rings++;
+    }
+    uint64_t* heads = (uint64_t*)malloc(sizeof(uint64_t) * (rings + 1));
+    bool failed = heads == NULL;
+    if (!failed) {
+        channel_trace_header_t header;
+        memcpy(header.magic, CHANNEL_TRACE_MAGIC, sizeof(header.magic));
+        header.start_ticks = trace_start_ticks;
+        header.ns_per_tick = channel_trace_ns_per_tick();
+        header.count = 0;
+        size_t i = 0;
+        for (channel_trace_ring_t* ring = trace_rings; ring; ring = ring->next, i++) {
+            heads[i] = atomic_load_explicit(&ring->head, memory_order_acquire);
+            header.count += channel_trace_kept(heads[i]);
+        }
+        fwrite(&header, sizeof(header), 1, out);
+
+        // Oldest first: from the slot after the newest event to the end, then from the start
+        i = 0;
+        for (channel_trace_ring_t* ring = trace_rings; ring; ring = ring->next, i++) {
+            uint64_t kept = channel_trace_kept(heads[i]);
+            size_t first = (size_t)((heads[i] - kept) & (CHANNEL_TRACE_RING_SIZE - 1));
+            size_t before_end = CHANNEL_TRACE_RING_SIZE - first;
+            if (before_end > kept) {
+                before_end = (size_t)kept;
+            }
+            fwrite(&ring->events[first], sizeof(channel_trace_event_t), before_end, out);
+            fwrite(&ring->events[0], sizeof(channel_trace_event_t), (size_t)kept - before_end, out);
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    free(heads);
+    failed = ferror(out) != 0 || failed;
+    failed = fclose(out) != 0 || failed;
+    return failed ? GEN_ERROR : SUCCESS;
+}
+
+// Writes the events of all threads to the file descriptor fd
+enum channel_status channel_trace_dump(int fd)
+{
+    // Write through a duplicate so that closing the stream leaves fd open
+    int copy = dup(fd);
+    if (copy < 0) {
+        return GEN_ERROR;
+    }
+    FILE* out = fdopen(copy, "w");
+    if (!out) {
+        close(copy);
+        return GEN_ERROR;
+    }
+    return channel_trace_write(out);
+}
+
+// Writes the events of all threads to the file at path
+enum channel_status channel_trace_dump_path(const char* path)
+{
+    if (!path) {
+        return GEN_ERROR;
+    }
+    return channel_trace_write(fopen(path, "w"));
+}
+
+// Drops all recorded events
+void channel_trace_reset(void)
+{
+    pthread_mutex_lock(&trace_lock);
+    for (channel_trace_ring_t* ring = trace_rings; ring; ring = ring->next) {
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,86 @@
+#ifndef CHANNEL_TRACE_H
+#define CHANNEL_TRACE_H
+
+#include <stdint.h>
+#include "channel.h"
+
+// Binary event trace of blocking channel operations
+// When channel.c is built with CHANNEL_TRACE (make TRACE=1) every blocking send, receive and
+// select records when it parks, when it wakes up and how it completed, and every wakeup of
+// sleeping threads records how many were woken
+// Each thread writes into its own ring of CHANNEL_TRACE_RING_SIZE events without any lock or
+// read-modify-write, overwriting its oldest events once the ring is full; the ring of a thread
+// that exits is handed to the next new thread with its events kept, so a stress run that keeps
+// creating threads only needs as many rings as threads run at once
+// channel_trace_dump writes the events of all rings to a file that the channel_trace_dump tool
+// converts to Chrome trace_event JSON (open it in Perfetto or chrome://tracing)
+
+// Number of events in the ring of each thread (log2)
+#ifndef CHANNEL_TRACE_RING_BITS
+#define CHANNEL_TRACE_RING_BITS 12
+#endif
+#define CHANNEL_TRACE_RING_SIZE (1u << CHANNEL_TRACE_RING_BITS)
+
+// First bytes of a trace file
+#define CHANNEL_TRACE_MAGIC "CHTRACE1"
+
+// Defines the events of the trace
+// CHANNEL_TRACE_SEND, CHANNEL_TRACE_RECEIVE and CHANNEL_TRACE_SELECT are recorded when a blocking
+// call returns, with its channel_status as outcome
+// CHANNEL_TRACE_*_PARK are recorded when the call goes to sleep and CHANNEL_TRACE_UNPARK when it
+// stops sleeping (for good, a call that wakes up and goes back to sleep stays parked)
+// CHANNEL_TRACE_WAKE is recorded by a thread that woke sleeping threads, with their number as outcome
+enum channel_trace_op {
+    CHANNEL_TRACE_SEND,
+    CHANNEL_TRACE_RECEIVE,
+    CHANNEL_TRACE_SELECT,
+    CHANNEL_TRACE_SEND_PARK,
+    CHANNEL_TRACE_RECEIVE_PARK,
+    CHANNEL_TRACE_SELECT_PARK,
+    CHANNEL_TRACE_UNPARK,
+    CHANNEL_TRACE_WAKE,
+};
+
+// Defines one event, 16 bytes
+// time is in ticks of histogram_now; channel is the id of the channel (see channel_t.id), or 0
+// for a select that parked on several channels; thread numbers the ring the event was recorded
+// in, so a thread that takes over the ring of an exited thread records under the same number and
+// shows up on the same track after it
+typedef struct {
+    uint64_t time;
+    uint32_t channel;
+    uint16_t thread;
+    uint8_t op;
+    int8_t outcome;
+} channel_trace_event_t;
+
+// Defines the header of a trace file, which is followed by count events
+// Event times are converted to nanoseconds since the start of tracing with
+// (time - start_ticks) * ns_per_tick
+typedef struct {
+    char magic[8];
+    uint64_t start_ticks;
+    double ns_per_tick;
+    uint64_t count;
+} channel_trace_header_t;
+
+// Records an event for the calling thread
+// Outcomes outside the range of int8_t are clamped
+void channel_trace_record(uint32_t channel, enum channel_trace_op op, int outcome);
+
+// Writes the events of all threads to the file descriptor fd, oldest first for each thread
+// Events recorded while the dump runs may or may not be included, and the oldest events of a
+// ring that is overwritten meanwhile may be torn, so dump once the traced threads are done
+// The descriptor is left open
+// Returns SUCCESS, or GEN_ERROR if writing failed
+enum channel_status channel_trace_dump(int fd);
+
+// Writes the events of all threads to the file at path, replacing its contents
+// Returns SUCCESS, or GEN_ERROR if the file could not be written
+enum channel_status channel_trace_dump_path(const char* path);
+
+// Drops all recorded events
+// Must not be called while other threads record events
+void channel_trace_reset(void);
+
+#endif // CHANNEL_TRACE_H
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "channel_trace.h"
+
+// Converts a trace written by channel_trace_dump to Chrome trace_event JSON
+// Usage: channel_trace_dump TRACE_FILE [JSON_FILE]
+// Parks become duration events on the thread that parked, completed calls and wakeups become
+// instant events; the channel id and the outcome are in the args of each event
+
+// Names of the events, indexed by enum channel_trace_op
+static const char* trace_op_names[] = {
+    "send",
+    "receive",
+    "select",
+    "send park",
+    "receive park",
+    "select park",
+    "unpark",
+    "wake",
+};
+#define TRACE_OPS (sizeof(trace_op_names) / sizeof(trace_op_names[0]))
+
+// Returns the name of a channel_status
+static const char* trace_status_name(int status)
+{
+    switch (status) {
+    case SUCCESS:
+        return "SUCCESS";
+    case CHANNEL_EMPTY:
+        return "CHANNEL_EMPTY";
+    case GEN_ERROR:
+        return "GEN_ERROR";
+    case CLOSED_ERROR:
+        return "CLOSED_ERROR";
+    case DESTROY_ERROR:
+        return "DESTROY_ERROR";
+    case TIMEOUT:
+        return "TIMEOUT";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+// An event and its position in the trace file, which orders events recorded at the same tick
+typedef struct {
+    channel_trace_event_t event;
+    size_t position;
+} trace_entry_t;
+
+// Orders events by time, keeping the order of the file for events recorded at the same tick
+static int trace_compare(const void* a, const void* b)
+{
+    const trace_entry_t* first = (const trace_entry_t*)a;
+    const trace_entry_t* second = (const trace_entry_t*)b;
+    if (first->event.time != second->event.time) {
+        return first->event.time < second->event.time ? -1 : 1;
+    }
+    return first->position < second->position ? -1 : first->position > second->position;
+}
+
+// Writes one event as a trace_event object
+static void trace_write_event(FILE* out, const channel_trace_header_t* header, const channel_trace_event_t* event)
+{
+    // Events from before the start of tracing cannot happen, but a clamped time is easier to read than a huge one
+    uint64_t ticks = event->time > header->start_ticks ? event->time - header->start_ticks : 0;
+    double us = (double)ticks * header->ns_per_tick / 1000.0;
+    const char* name = event->op < TRACE_OPS ? trace_op_names[event->op] : "unknown";
+    fprintf(out, "{\"pid\":1,\"tid\":%u,\"ts\":%.3f,", (unsigned)event->thread, us);
+    switch (event->op) {
+    case CHANNEL_TRACE_SEND_PARK:
+    case CHANNEL_TRACE_RECEIVE_PARK:
+    case CHANNEL_TRACE_SELECT_PARK:
+        fprintf(out, "\"ph\":\"B\",\"cat\":\"park\",\"name\":\"%s\",\"args\":{\"channel\":%u}}", name,
+                (unsigned)event->channel);
+        break;
+    case CHANNEL_TRACE_UNPARK:
+        fprintf(out, "\"ph\":\"E\",\"cat\":\"park\",\"args\":{\"channel\":%u}}", (unsigned)event->channel);
+        break;
+    case CHANNEL_TRACE_WAKE:
+        fprintf(out, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"wake\",\"name\":\"%s\",\"args\":{\"channel\":%u,\"woken\":%d}}",
+                name, (unsigned)event->channel, event->outcome);
+        break;
+    default:
+        fprintf(out, "\"ph\":\"i\",\"s\":\"t\",\"cat\":\"op\",\"name\":\"%s\",\"args\":{\"channel\":%u,\"status\":\"%s\"}}",
+                name, (unsigned)event->channel, trace_status_name(event->outcome));
+        break;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s TRACE_FILE [JSON_FILE]\n", argv[0]);
+        return 2;
+    }
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    channel_trace_header_t header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, CHANNEL_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: not a channel trace\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+    trace_entry_t* entries = (trace_entry_t*)malloc(sizeof(trace_entry_t) * (header.count + 1));
+    if (!entries) {
+        fprintf(stderr, "Out of memory\n");
+        fclose(in);
+        return 1;
+    }
+    size_t count = 0;
+    while (count < header.count && fread(&entries[count].event, sizeof(channel_trace_event_t), 1, in) == 1) {
+        entries[count].position = count;
+        count++;
+    }
+    fclose(in);
+    if (count != header.count) {
+        fprintf(stderr, "%s: truncated, converting the first %zu events\n", argv[1], count);
+    }
+    qsort(entries, count, sizeof(trace_entry_t), trace_compare);
+
+    FILE* out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        free(entries);
+        return 1;
+    }
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (size_t i = 0; i < count; i++) {
+        fputs(i == 0 ? "\n" : ",\n", out);
+        trace_write_event(out, &header, &entries[i].event);
+    }
+    fputs("\n]}\n", out);
+    free(entries);
+    bool failed = ferror(out) != 0;
+    failed = fclose(out) != 0 || failed;
+    return failed ? 1 : 0;
+}
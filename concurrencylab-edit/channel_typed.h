@@ -0,0 +1,104 @@
+#ifndef CHANNEL_TYPED_H
+#define CHANNEL_TYPED_H
+
+#include "channel.h"
+
+// Typed channels specialized at compile time
+// CHANNEL_DEFINE(name, T, CAPACITY) defines these functions for values of type T:
+//   channel_t* name_create(void)                                         a channel of CAPACITY values
+//   enum channel_status name_send(channel_t* channel, T value)
+//   enum channel_status name_receive(channel_t* channel, T* value)
+//   enum channel_status name_non_blocking_send(channel_t* channel, T value)
+//   enum channel_status name_non_blocking_receive(channel_t* channel, T* value)
+//   select_t name_select(channel_t* channel, enum direction dir, T* value)  an entry for channel_select
+// The channel is an ordinary typed channel (see channel_create_typed), closed and destroyed with
+// channel_close/channel_destroy and usable with the *_value functions and every select
+// The fast path (room in the buffer for a send, a value for a receive) is inlined at the call
+// site with the size of T and the number of slots as constants, so the copy is a fixed-size move
+// and the slot index a constant mask; only the wakeup of the other side is a call
+// Whenever the fast path cannot complete, or the channel was not created by name_create (another
+// capacity, or recording latency), the functions fall back to their channel_*_value counterparts
+// and return their statuses; a channel whose values are not sizeof(T) bytes gives GEN_ERROR
+// Use at file scope; CAPACITY must be a positive integer constant
+#define CHANNEL_DEFINE(name, T, CAPACITY)                                                            \
+    _Static_assert((CAPACITY) > 0, "CHANNEL_DEFINE: the capacity of " #name " must be positive");   \
+    static inline channel_t* name##_create(void)                                                     \
+    {                                                                                                \
+        return channel_create_typed((CAPACITY), sizeof(T));                                          \
+    }                                                                                                \
+    static inline enum channel_status name##_send(channel_t* channel, T value)                      \
+    {                                                                                                \
+        return channel_typed_send(channel, &value, (CAPACITY), sizeof(T), true);                     \
+    }                                                                                                \
+    static inline enum channel_status name##_receive(channel_t* channel, T* value)                  \
+    {                                                                                                \
+        return channel_typed_receive(channel, value, (CAPACITY), sizeof(T), true);                   \
+    }                                                                                                \
+    static inline enum channel_status name##_non_blocking_send(channel_t* channel, T value)         \
+    {                                                                                                \
+        return channel_typed_send(channel, &value, (CAPACITY), sizeof(T), false);                    \
+    }                                                                                                \
+    static inline enum channel_status name##_non_blocking_receive(channel_t* channel, T* value)     \
+    {                                                                                                \
+        return channel_typed_receive(channel, value, (CAPACITY), sizeof(T), false);                  \
+    }                                                                                                \
+    static inline select_t name##_select(channel_t* channel, enum direction dir, T* value)          \
+    {                                                                                                \
+        select_t entry = { channel, dir, value };                                                    \
+        return entry;                                                                                \
+    }
+
+// Finishes a send (receive) whose value the inline fast path added to (removed from) the buffer
+// itself: wakes the other side like the out-of-line functions do, under the call site of a
+// blocking call or a non-blocking one
+void channel_typed_sent(channel_t* channel, bool blocking);
+void channel_typed_received(channel_t* channel, bool blocking);
+
+// The helpers below are always inlined into the functions CHANNEL_DEFINE defines, so that
+// capacity and elem_size are constants in them
+
+// Returns true if the fast path may use the buffer of an open typed channel with the given capacity
+BUFFER_INLINE bool channel_typed_inline(channel_t* channel, size_t capacity)
+{
+    buffer_t* buffer = channel->buffer;
+    return buffer->capacity == capacity && buffer->slots == BUFFER_SLOTS(capacity) && !buffer->stamps &&
+           atomic_load_explicit(&channel->closed, memory_order_acquire) != 0;
+}
+
+// Returns true if channel holds values of elem_size bytes
+BUFFER_INLINE bool channel_typed_holds(channel_t* channel, size_t elem_size)
+{
+    return channel && channel->kind == CHANNEL_TYPED && channel->buffer->elem_size == elem_size;
+}
+
+// Body of name_send and name_non_blocking_send, called with constant capacity and elem_size
+BUFFER_INLINE enum channel_status channel_typed_send(channel_t* channel, const void* value, size_t capacity,
+                                                     size_t elem_size, bool blocking)
+{
+    if (!channel_typed_holds(channel, elem_size)) {
+        return GEN_ERROR;
+    }
+    if (channel_typed_inline(channel, capacity) &&
+        buffer_add_value_fixed(channel->buffer, value, capacity, elem_size) == BUFFER_SUCCESS) {
+        channel_typed_sent(channel, blocking);
+        return SUCCESS;
+    }
+    return blocking ? channel_send_value(channel, value) : channel_non_blocking_send_value(channel, value);
+}
+
+// Body of name_receive and name_non_blocking_receive, called with constant capacity and elem_size
+BUFFER_INLINE enum channel_status channel_typed_receive(channel_t* channel, void* value, size_t capacity,
+                                                        size_t elem_size, bool blocking)
+{
+    if (!value || !channel_typed_holds(channel, elem_size)) {
+        return GEN_ERROR;
+    }
+    if (channel_typed_inline(channel, capacity) &&
+        buffer_remove_value_fixed(channel->buffer, value, capacity, elem_size) == BUFFER_SUCCESS) {
+        channel_typed_received(channel, blocking);
+        return SUCCESS;
+    }
+    return blocking ? channel_receive_value(channel, value) : channel_non_blocking_receive_value(channel, value);
+}
+
+#endif // CHANNEL_TYPED_H
@@ -0,0 +1,48 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Thin wrappers around the Linux futex system call
+// A futex word is a 32-bit counter that wakers bump before calling futex_wake, so a
+// thread that read the old value and then goes to sleep with futex_wait returns at once
+// instead of missing the wakeup
+// Only process-private futexes are used, which skips the kernel's shared-mapping lookup
+typedef atomic_uint futex_word_t;
+
+// Wakes every thread sleeping on the word
+#define FUTEX_WAKE_ALL INT_MAX
+
+// Sleeps until the word is woken, as long as it still holds expected
+// May return early (for a signal or a spurious wakeup); callers re-check their condition
+static inline void futex_wait(futex_word_t* word, unsigned expected)
+{
+    syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+// Like futex_wait, but gives up at the absolute CLOCK_MONOTONIC time deadline
+// A NULL deadline waits forever
+// Returns true if the deadline passed
+static inline bool futex_wait_until(futex_word_t* word, unsigned expected, const struct timespec* deadline)
+{
+    // FUTEX_WAIT_BITSET takes an absolute timeout on CLOCK_MONOTONIC, unlike FUTEX_WAIT
+    long result = syscall(SYS_futex, (unsigned*)word, FUTEX_WAIT_BITSET_PRIVATE, expected, deadline, NULL,
+                          FUTEX_BITSET_MATCH_ANY);
+    return result == -1 && errno == ETIMEDOUT;
+}
+
+// Wakes up to count threads sleeping on the word
+// Returns the number of threads woken
+static inline int futex_wake(futex_word_t* word, int count)
+{
+    return (int)syscall(SYS_futex, (unsigned*)word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+#endif // FUTEX_H
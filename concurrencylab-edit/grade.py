@@ -103,6 +103,29 @@ add_test_case_channel("test_stress_mixed_buffered_unbuffered", iters_one, timeou
 add_test_case_sanitize("test_stress_mixed_buffered_unbuffered", iters_one, timeout_sanitize * 3)
 add_test_case_valgrind("test_stress_mixed_buffered_unbuffered", iters_one, timeout_valgrind * 3)
 
+# Extensions
+add_test_cases("test_spsc", iters_one)
+add_test_cases("test_mpsc", iters_one)
+add_test_cases("test_send_receive_many", iters_one)
+add_test_cases("test_wait_policies", iters_one)
+add_test_cases("test_timed", iters_one)
+add_test_cases("test_buffer_layout", iters_one)
+add_test_cases("test_stats", iters_one)
+add_test_cases("test_lock_stats", iters_one)
+add_test_cases("test_registry", iters_one)
+add_test_cases("test_latency", iters_one)
+add_test_cases("test_trace", iters_one)
+add_test_cases("test_select_fairness", iters_one)
+add_test_cases("test_select_non_blocking", iters_one)
+add_test_cases("test_select_set", iters_one)
+add_test_cases("test_select_ready", iters_one)
+add_test_cases("test_broadcast", iters_one)
+add_test_cases("test_broadcast_many", iters_one)
+add_test_cases("test_conflating", iters_one)
+add_test_cases("test_lossy", iters_one)
+add_test_cases("test_typed", iters_one)
+add_test_cases("test_typed_define", iters_one)
+
 # Score distribution
 point_breakdown = [
     # Basic (162 pts)
@@ -0,0 +1,140 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "histogram.h"
+
+// Returns the CLOCK_MONOTONIC time in nanoseconds
+static uint64_t histogram_clock_ns(const struct timespec* time)
+{
+    return (uint64_t)time->tv_sec * 1000000000u + (uint64_t)time->tv_nsec;
+}
+
+// Returns the bucket of a value
+static inline size_t histogram_bucket(uint64_t value)
+{
+    if (value < 2 * HISTOGRAM_SUB_BUCKET_HALF) {
+        return (size_t)value;
+    }
+    // Keep the top HISTOGRAM_SUB_BUCKET_BITS bits of the value
+    unsigned shift = (unsigned)(63 - __builtin_clzll(value)) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    return (size_t)shift * HISTOGRAM_SUB_BUCKET_HALF + (size_t)(value >> shift);
+}
+
+// Returns the highest value that falls into a bucket
+static inline uint64_t histogram_bucket_limit(size_t bucket)
+{
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKET_HALF) {
+        return bucket;
+    }
+    unsigned shift = (unsigned)(bucket / HISTOGRAM_SUB_BUCKET_HALF) - 1;
+    uint64_t top = bucket % HISTOGRAM_SUB_BUCKET_HALF + HISTOGRAM_SUB_BUCKET_HALF;
+    return ((top + 1) << shift) - 1;
+}
+
+// Returns the shard of the calling thread
+static inline histogram_shard_t* histogram_shard(histogram_t* histogram)
+{
+    uint64_t id = (uint64_t)(uintptr_t)pthread_self();
+    return &histogram->shards[(id * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - HISTOGRAM_SHARD_BITS)];
+}
+
+// Returns the number of durations recorded in a bucket, summed over the shards
+static uint64_t histogram_bucket_count(histogram_t* histogram, size_t bucket)
+{
+    uint64_t count = 0;
+    for (size_t s = 0; s < HISTOGRAM_SHARDS; s++) {
+        count += atomic_load_explicit(&histogram->shards[s].counts[bucket], memory_order_relaxed);
+    }
+    return count;
+}
+
+// Creates an empty histogram
+histogram_t* histogram_create(void)
+{
+    histogram_t* histogram = (histogram_t*) aligned_alloc(HISTOGRAM_CACHE_LINE, sizeof(histogram_t));
+    if (!histogram) {
+        return NULL;
+    }
+    for (size_t s = 0; s < HISTOGRAM_SHARDS; s++) {
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            atomic_init(&histogram->shards[s].counts[i], 0);
+        }
+    }
+    atomic_init(&histogram->max, 0);
+    clock_gettime(CLOCK_MONOTONIC, &histogram->start_time);
+    histogram->start_ticks = histogram_now();
+    return histogram;
+}
+
+// Frees the memory allocated to the histogram
+void histogram_free(histogram_t* histogram)
+{
+    free(histogram);
+}
+
+// Adds a duration (in ticks) to the histogram
+void histogram_record(histogram_t* histogram, uint64_t ticks)
+{
+    atomic_fetch_add_explicit(&histogram_shard(histogram)->counts[histogram_bucket(ticks)], 1, memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (ticks > max &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max, &max, ticks, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Returns the number of recorded durations
+uint64_t histogram_count(histogram_t* histogram)
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        count += histogram_bucket_count(histogram, i);
+    }
+    return count;
+}
+
+// Returns the duration in ticks that the given fraction of recorded durations do not exceed
+uint64_t histogram_percentile(histogram_t* histogram, double fraction)
+{
+    uint64_t count = histogram_count(histogram);
+    if (count == 0) {
+        return 0;
+    }
+    // Rank of the value we are looking for, counting from 1
+    uint64_t rank = (uint64_t)(fraction * (double)count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t max = histogram_max(histogram);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram_bucket_count(histogram, i);
+        if (seen >= rank) {
+            uint64_t limit = histogram_bucket_limit(i);
+            return limit < max ? limit : max;
+        }
+    }
+    return max;
+}
+
+// Returns the longest recorded duration in ticks
+uint64_t histogram_max(histogram_t* histogram)
+{
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+// Returns the length of a tick in nanoseconds
+double histogram_ns_per_tick(histogram_t* histogram)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t elapsed_ticks = histogram_now() - histogram->start_ticks;
+    uint64_t elapsed_ns = histogram_clock_ns(&now) - histogram_clock_ns(&histogram->start_time);
+    if (elapsed_ticks == 0) {
+        return 1.0;
+    }
+    return (double)elapsed_ns / (double)elapsed_ticks;
+#else
+    (void)histogram;
+    return 1.0;
+#endif
+}
@@ -0,0 +1,78 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// Log-linear (HDR-style) histogram of durations
+// Values below 2^HISTOGRAM_SUB_BUCKET_BITS get a bucket each; above that every power of two
+// is split into 2^(HISTOGRAM_SUB_BUCKET_BITS - 1) equal buckets, so any recorded value is
+// reported within about 3% while the whole 64-bit range fits in a fixed array
+// Durations are recorded in ticks of histogram_now (the time stamp counter where there is
+// one) and converted to nanoseconds only when the histogram is read
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_SUB_BUCKET_HALF (1 << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_SUB_BUCKET_HALF)
+
+// Number of copies of the bucket counts (log2)
+// Threads hash onto shards like the counters of channel_get_stats, so threads recording the same
+// duration at the same time do not all update one cache line; each shard costs about 8KB
+#define HISTOGRAM_SHARD_BITS 2
+#define HISTOGRAM_SHARDS (1 << HISTOGRAM_SHARD_BITS)
+#define HISTOGRAM_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(HISTOGRAM_CACHE_LINE) atomic_uint_fast64_t counts[HISTOGRAM_BUCKETS];
+} histogram_shard_t;
+
+typedef struct {
+    histogram_shard_t shards[HISTOGRAM_SHARDS];
+    // Only written when a record exceeds it, which stops happening once the tail is seen
+    _Alignas(HISTOGRAM_CACHE_LINE) atomic_uint_fast64_t max;
+
+    // Tick count and time at creation, used to convert ticks to nanoseconds
+    uint64_t start_ticks;
+    struct timespec start_time;
+} histogram_t;
+
+// Creates an empty histogram
+histogram_t* histogram_create(void);
+
+// Frees the memory allocated to the histogram
+void histogram_free(histogram_t* histogram);
+
+// Returns the current time in ticks
+// Cheap enough to call on every message: a single rdtsc on x86, clock_gettime elsewhere
+static inline uint64_t histogram_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+// Adds a duration (in ticks) to the histogram
+// Safe to call concurrently from any number of threads; costs one relaxed atomic add on the
+// calling thread's shard, plus a compare-and-swap for a new maximum
+void histogram_record(histogram_t* histogram, uint64_t ticks);
+
+// Returns the number of recorded durations
+uint64_t histogram_count(histogram_t* histogram);
+
+// Returns the duration in ticks that the given fraction (0 to 1) of recorded
+// durations do not exceed, or 0 if nothing was recorded
+uint64_t histogram_percentile(histogram_t* histogram, double fraction);
+
+// Returns the longest recorded duration in ticks
+uint64_t histogram_max(histogram_t* histogram);
+
+// Returns the length of a tick in nanoseconds
+// The tick rate is measured over the lifetime of the histogram, so use one result to
+// convert all the values of a snapshot
+double histogram_ns_per_tick(histogram_t* histogram);
+
+#endif // HISTOGRAM_H
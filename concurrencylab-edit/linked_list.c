@@ -3,66 +3,107 @@
 // Creates and returns a new list
 list_t* list_create()
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    return NULL;
+    list_t* list = (list_t*) malloc(sizeof(list_t));
+    if (list == NULL) {
+        return NULL;
+    }
+    list->head = NULL;
+    list->count = 0;
+    return list;
 }
 
 // Destroys a list
 void list_destroy(list_t* list)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
+    list_node_t* node = list->head;
+    while (node != NULL) {
+        list_node_t* next = node->next;
+        free(node);
+        node = next;
+    }
+    free(list);
 }
 
 // Returns beginning of the list
 list_node_t* list_begin(list_t* list)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    return NULL;
+    return list->head;
 }
 
 // Returns next element in the list
 list_node_t* list_next(list_node_t* node)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    return NULL;
+    return node->next;
 }
 
 // Returns data in the given list node
 void* list_data(list_node_t* node)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    return NULL;
+    return node->data;
 }
 
 // Returns the number of elements in the list
 size_t list_count(list_t* list)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
-    return 0;
+    return list->count;
 }
 
 // Finds the first node in the list with the given data
 // Returns NULL if data could not be found
 list_node_t* list_find(list_t* list, void* data)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
+    for (list_node_t* node = list->head; node != NULL; node = node->next) {
+        if (node->data == data) {
+            return node;
+        }
+    }
     return NULL;
 }
 
 // Inserts a new node in the list with the given data
+// Nodes are appended, and the head's prev pointer tracks the last node so that
+// appending stays constant time
 void list_insert(list_t* list, void* data)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
+    list_node_t* node = (list_node_t*) malloc(sizeof(list_node_t));
+    node->data = data;
+    node->next = NULL;
+    if (list->head == NULL) {
+        node->prev = node;
+        list->head = node;
+    } else {
+        list_node_t* tail = list->head->prev;
+        tail->next = node;
+        node->prev = tail;
+        list->head->prev = node;
+    }
+    list->count++;
 }
 
 // Removes a node from the list and frees the node resources
 void list_remove(list_t* list, list_node_t* node)
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
+    if (node == list->head) {
+        list->head = node->next;
+        if (list->head != NULL) {
+            list->head->prev = node->prev;
+        }
+    } else {
+        node->prev->next = node->next;
+        if (node->next != NULL) {
+            node->next->prev = node->prev;
+        } else {
+            list->head->prev = node->prev;
+        }
+    }
+    list->count--;
+    free(node);
 }
 
 // Executes a function for each element in the list
 void list_foreach(list_t* list, void (*func)(void* data))
 {
-    /* IMPLEMENT THIS IF YOU WANT TO USE LINKED LISTS */
+    for (list_node_t* node = list->head; node != NULL; node = node->next) {
+        func(node->data);
+    }
 }
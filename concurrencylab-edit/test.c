@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include "channel.h"
+#include "channel_registry.h"
+#include "channel_trace.h"
+#include "channel_typed.h"
 #include <assert.h>
 #include <unistd.h>
 #include <stdint.h>
@@ -44,6 +47,50 @@ typedef struct {
     pthread_t pid;
 } cpu_args;
 
+typedef struct {
+    channel_t *channel;
+    size_t start;
+    size_t count;
+    enum channel_status out;
+} sequence_args;
+
+typedef struct {
+    channel_t *channel;
+    pthread_barrier_t *start;
+    pthread_barrier_t *end;
+    size_t rounds;
+    bool blocking;
+    void *value;
+    enum channel_status out;
+} mpsc_round_args;
+
+typedef struct {
+    channel_t *channel;
+    atomic_int *seen;
+    size_t received;
+    bool ordered;
+} lossy_args;
+
+// Value of a typed channel, larger than a pointer; check detects torn copies
+typedef struct {
+    uint64_t producer;
+    uint64_t seq;
+    uint64_t check;
+    char tag[16];
+} typed_message;
+
+typedef struct {
+    channel_t *channel;
+    uint64_t producer;
+    size_t count;
+    size_t received;
+    bool valid;
+} typed_args;
+
+// Channels specialized at compile time; count_channel has spare slots (3 values in 4 slots)
+CHANNEL_DEFINE(message_channel, typed_message, 4)
+CHANNEL_DEFINE(count_channel, uint64_t, 3)
+
 int tests_run = 0;
 int tests_passed = 0;
 
@@ -123,6 +170,158 @@ void* helper_non_blocking_receive(receive_args* myargs) {
     return NULL;
 }
 
+void init_object_for_sequence(sequence_args* new_args, channel_t* channel, size_t start, size_t count) {
+    new_args->channel = channel;
+    new_args->start = start;
+    new_args->count = count;
+    new_args->out = GEN_ERROR;
+}
+
+void* helper_send_sequence(sequence_args *myargs) {
+    // Sends start, start + 1, ..., start + count - 1 and stops at the first failure
+    myargs->out = SUCCESS;
+    for (size_t i = 0; i < myargs->count && myargs->out == SUCCESS; i++) {
+        myargs->out = channel_send(myargs->channel, (void*)(myargs->start + i));
+    }
+    return NULL;
+}
+
+void* helper_mpsc_round(mpsc_round_args *myargs) {
+    // Sends value once per round between the two barriers, blocking or not
+    for (size_t i = 0; i < myargs->rounds; i++) {
+        pthread_barrier_wait(myargs->start);
+        myargs->out = myargs->blocking ? channel_send(myargs->channel, myargs->value)
+                                       : channel_non_blocking_send(myargs->channel, myargs->value);
+        pthread_barrier_wait(myargs->end);
+    }
+    return NULL;
+}
+
+void* helper_send_sequence_many(sequence_args *myargs) {
+    // Sends start, start + 1, ..., start + count - 1 in bursts of up to 64 values
+    void* items[64];
+    myargs->out = SUCCESS;
+    for (size_t i = 0; i < myargs->count && myargs->out == SUCCESS;) {
+        size_t n = 0;
+        while (n < 64 && i + n < myargs->count) {
+            items[n] = (void*)(myargs->start + i + n);
+            n++;
+        }
+        size_t sent = 0;
+        myargs->out = channel_send_many(myargs->channel, items, n, &sent);
+        i += sent;
+    }
+    return NULL;
+}
+
+void* helper_receive_sequence(sequence_args *myargs) {
+    // Receives count values and checks that they are start, start + 1, ...
+    myargs->out = SUCCESS;
+    for (size_t i = 0; i < myargs->count && myargs->out == SUCCESS; i++) {
+        void* data = NULL;
+        myargs->out = channel_receive(myargs->channel, &data);
+        if (myargs->out == SUCCESS && (size_t)data != myargs->start + i) {
+            myargs->out = GEN_ERROR;
+        }
+    }
+    return NULL;
+}
+
+void* helper_receive_sequence_many(sequence_args *myargs) {
+    // Same as helper_receive_sequence, in bursts of up to 3 values
+    void* out[3];
+    myargs->out = SUCCESS;
+    for (size_t i = 0; i < myargs->count && myargs->out == SUCCESS;) {
+        size_t max = myargs->count - i < 3 ? myargs->count - i : 3;
+        size_t got = 0;
+        myargs->out = channel_receive_many(myargs->channel, out, max, &got);
+        for (size_t j = 0; j < got && myargs->out == SUCCESS; j++, i++) {
+            if ((size_t)out[j] != myargs->start + i) {
+                myargs->out = GEN_ERROR;
+            }
+        }
+    }
+    return NULL;
+}
+
+void* helper_receive_lossy(lossy_args *myargs) {
+    // Receives until the value 0, counting every other value in seen and checking that
+    // they arrive in increasing order
+    size_t last = 0;
+    myargs->received = 0;
+    myargs->ordered = true;
+    while (1) {
+        void* data = NULL;
+        if (channel_receive(myargs->channel, &data) != SUCCESS || data == NULL) {
+            break;
+        }
+        size_t value = (size_t)data;
+        myargs->ordered = myargs->ordered && value > last;
+        last = value;
+        atomic_fetch_add(&myargs->seen[value], 1);
+        myargs->received++;
+    }
+    return NULL;
+}
+
+void* helper_send_typed(typed_args *myargs) {
+    // Sends count messages numbered from 1
+    for (size_t i = 1; i <= myargs->count; i++) {
+        typed_message message = { myargs->producer, i, myargs->producer * 1000003 ^ i, "typed" };
+        if (channel_send_value(myargs->channel, &message) != SUCCESS) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void helper_check_typed(typed_args *myargs, typed_message *message, uint64_t *last) {
+    // Checks that the message is intact and that the messages of its producer arrive in order
+    myargs->valid = myargs->valid && message->producer < 3 && message->seq > last[message->producer] &&
+                    message->check == (message->producer * 1000003 ^ message->seq) && string_equal(message->tag, "typed");
+    if (message->producer < 3) {
+        last[message->producer] = message->seq;
+    }
+    myargs->received++;
+}
+
+void* helper_select_typed(typed_args *myargs) {
+    // Receives through select until a message from producer 0
+    typed_message message;
+    uint64_t last[3] = { 0, 0, 0 };
+    select_t entry = { myargs->channel, RECV, &message };
+    size_t index;
+    myargs->received = 0;
+    myargs->valid = true;
+    while (channel_select(&entry, 1, &index) == SUCCESS && message.producer != 0) {
+        helper_check_typed(myargs, &message, last);
+    }
+    return NULL;
+}
+
+void* helper_send_defined(typed_args *myargs) {
+    // Sends count messages numbered from 1 through the inline fast path
+    for (size_t i = 1; i <= myargs->count; i++) {
+        typed_message message = { myargs->producer, i, myargs->producer * 1000003 ^ i, "typed" };
+        if (message_channel_send(myargs->channel, message) != SUCCESS) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+void* helper_receive_defined(typed_args *myargs) {
+    // Receives through the inline fast path until a message from producer 0
+    typed_message message;
+    uint64_t last[3] = { 0, 0, 0 };
+    myargs->received = 0;
+    myargs->valid = true;
+    while (message_channel_receive(myargs->channel, &message) == SUCCESS && message.producer != 0) {
+        helper_check_typed(myargs, &message, last);
+    }
+    return NULL;
+}
+
 char* test_initialization() {
     print_test_details(__func__, "Testing the channel intialization");
 
@@ -138,6 +337,14 @@ char* test_initialization() {
     channel_close(channel);
     channel_destroy(channel);
 
+#ifndef __SANITIZE_THREAD__
+    /* A channel whose buffer cannot be allocated is not created (ThreadSanitizer aborts on such an allocation instead) */
+    size_t huge = (size_t)1 << 50;
+    mu_assert("test_initialization: Created a channel without a buffer\n", channel_create(huge) == NULL);
+    mu_assert("test_initialization: Created a broadcast channel without a buffer\n", channel_create_broadcast(huge) == NULL);
+    mu_assert("test_initialization: Created a typed channel without a buffer\n", channel_create_typed(huge, sizeof(uint64_t)) == NULL);
+#endif
+
     return NULL;
 }
 
@@ -2003,6 +2210,1517 @@ char* test_select_mixed_buffered_unbuffered() {
     return NULL;
 }
 
+char* test_spsc() {
+    print_test_details(__func__, "Testing single-producer/single-consumer channel");
+
+    /* One sender pushes a numbered sequence through a small SPSC channel and
+     * the receiver must see every message exactly once and in order
+     */
+    size_t capacity = 4;
+    size_t MESSAGES = 100000;
+    channel_t* channel = channel_create_spsc(capacity);
+    mu_assert("test_spsc: Could not create channel", channel != NULL);
+    mu_assert("test_spsc: Buffer capacity is not as expected", buffer_capacity(channel->buffer) == capacity);
+
+    pthread_t pid;
+    sequence_args args;
+    init_object_for_sequence(&args, channel, 1, MESSAGES);
+    pthread_create(&pid, NULL, (void *)helper_send_sequence, &args);
+
+    for (size_t i = 1; i <= MESSAGES; i++) {
+        void* data = NULL;
+        mu_assert("test_spsc: Testing channel receive return failed", channel_receive(channel, &data) == SUCCESS);
+        mu_assert("test_spsc: Messages were not received in order", (size_t)data == i);
+    }
+    pthread_join(pid, NULL);
+    mu_assert("test_spsc: Testing channel send return failed", args.out == SUCCESS);
+
+    /* Non-blocking calls report empty and full like a regular channel */
+    void* data = NULL;
+    mu_assert("test_spsc: Testing non blocking receive on empty channel", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+    for (size_t i = 0; i < capacity; i++) {
+        mu_assert("test_spsc: Testing non blocking send", channel_non_blocking_send(channel, "Message") == SUCCESS);
+    }
+    mu_assert("test_spsc: Testing non blocking send on full channel", channel_non_blocking_send(channel, "Message") == CHANNEL_FULL);
+
+    /* A sender blocked on the full channel is released by close */
+    send_args send_;
+    init_object_for_send_api(&send_, channel, "Message", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    usleep(10000);
+    mu_assert("test_spsc: It isn't blocked as expected", send_.out == GEN_ERROR);
+
+    mu_assert("test_spsc: Can't close channel", channel_close(channel) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_spsc: Blocked send should return CLOSED_ERROR", send_.out == CLOSED_ERROR);
+    mu_assert("test_spsc: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    return NULL;
+}
+
+char* test_mpsc() {
+    print_test_details(__func__, "Testing multi-producer/single-consumer channel");
+
+    /* Several senders push their own numbered sequence through one MPSC channel.
+     * The single receiver must get every message exactly once, and the messages
+     * of each sender in the order they were sent
+     */
+    size_t capacity = 4;
+    size_t SEND_THREAD = 4;
+    size_t MESSAGES = 20000;
+    channel_t* channel = channel_create_mpsc(capacity);
+    mu_assert("test_mpsc: Could not create channel", channel != NULL);
+    mu_assert("test_mpsc: Buffer capacity is not as expected", buffer_capacity(channel->buffer) == capacity);
+
+    pthread_t pid[SEND_THREAD];
+    sequence_args args[SEND_THREAD];
+    size_t last[SEND_THREAD];
+    for (size_t i = 0; i < SEND_THREAD; i++) {
+        last[i] = 0;
+        init_object_for_sequence(&args[i], channel, i * MESSAGES + 1, MESSAGES);
+        pthread_create(&pid[i], NULL, (void *)helper_send_sequence, &args[i]);
+    }
+
+    for (size_t i = 0; i < SEND_THREAD * MESSAGES; i++) {
+        void* data = NULL;
+        mu_assert("test_mpsc: Testing channel receive return failed", channel_receive(channel, &data) == SUCCESS);
+        size_t value = (size_t)data;
+        mu_assert("test_mpsc: Received invalid message", 1 <= value && value <= SEND_THREAD * MESSAGES);
+        size_t sender = (value - 1) / MESSAGES;
+        mu_assert("test_mpsc: Messages of one sender were not received in order", value > last[sender]);
+        last[sender] = value;
+    }
+    for (size_t i = 0; i < SEND_THREAD; i++) {
+        pthread_join(pid[i], NULL);
+        mu_assert("test_mpsc: Testing channel send return failed", args[i].out == SUCCESS);
+        mu_assert("test_mpsc: Missing messages", last[i] == (i + 1) * MESSAGES);
+    }
+
+    /* Each round a blocking sender and a few non-blocking senders race for the only slot of a
+     * full channel while the receiver empties it. A non-blocking send that finds the channel
+     * full must not hold on to room, or the blocking sender parks on an empty channel that
+     * nobody sends to again; the timed receive catches such a lost wakeup
+     */
+    size_t ROUNDS = 20000;
+    size_t NON_BLOCKING = 3;
+    channel_t* single = channel_create_mpsc(1);
+    mu_assert("test_mpsc: Could not create channel", single != NULL);
+    pthread_barrier_t start, end;
+    pthread_barrier_init(&start, NULL, (unsigned)NON_BLOCKING + 2);
+    pthread_barrier_init(&end, NULL, (unsigned)NON_BLOCKING + 2);
+    pthread_t round_pid[NON_BLOCKING + 1];
+    mpsc_round_args round_args[NON_BLOCKING + 1];
+    for (size_t i = 0; i <= NON_BLOCKING; i++) {
+        round_args[i] = (mpsc_round_args){single, &start, &end, ROUNDS, i == 0, i == 0 ? "Blocking" : "Non-blocking", GEN_ERROR};
+        pthread_create(&round_pid[i], NULL, (void *)helper_mpsc_round, &round_args[i]);
+    }
+    bool woken = true;
+    for (size_t i = 0; i < ROUNDS; i++) {
+        void* data = NULL;
+        channel_non_blocking_send(single, "Full");
+        pthread_barrier_wait(&start);
+        while (woken && data != round_args[0].value) {
+            struct timespec deadline;
+            convertTimeToTimespec(getTime() + convertSecondsToTime(5), &deadline);
+            woken = channel_receive_timed(single, &data, &deadline) == SUCCESS;
+        }
+        if (!woken) {
+            // Release the stuck sender so the threads can finish
+            channel_close(single);
+        }
+        pthread_barrier_wait(&end);
+        while (channel_non_blocking_receive(single, &data) == SUCCESS) {
+        }
+    }
+    for (size_t i = 0; i <= NON_BLOCKING; i++) {
+        pthread_join(round_pid[i], NULL);
+    }
+    pthread_barrier_destroy(&start);
+    pthread_barrier_destroy(&end);
+    mu_assert("test_mpsc: Blocked sender was not woken", woken);
+    mu_assert("test_mpsc: Testing channel send return failed", round_args[0].out == SUCCESS);
+    mu_assert("test_mpsc: Can't close channel", channel_close(single) == SUCCESS);
+    mu_assert("test_mpsc: Can't destroy channel", channel_destroy(single) == SUCCESS);
+
+    /* The channel is selectable like a regular one: a blocked RECV select wakes on a later send,
+     * a SEND select goes through while there is room and a blocked one wakes on a receive
+     */
+    void* data = NULL;
+    channel_t* other = channel_create(1);
+    select_t list[2] = {{.channel = other, .dir = RECV}, {.channel = channel, .dir = RECV}};
+    select_args select_;
+    init_object_for_select_api(&select_, list, 2, NULL);
+    pthread_create(&pid[0], NULL, (void *)helper_select, &select_);
+    usleep(10000);
+    mu_assert("test_mpsc: Select isn't blocked as expected", select_.out == GEN_ERROR);
+    mu_assert("test_mpsc: Testing channel send", channel_send(channel, "Select") == SUCCESS);
+    pthread_join(pid[0], NULL);
+    mu_assert("test_mpsc: Select should receive from the MPSC channel",
+              select_.out == SUCCESS && select_.index == 1 && string_equal(list[1].data, "Select"));
+
+    list[1].dir = SEND;
+    list[1].data = "Message";
+    size_t index = 0;
+    mu_assert("test_mpsc: Select send on channel with room",
+              channel_select(list, 2, &index) == SUCCESS && index == 1);
+    for (size_t i = 1; i < capacity; i++) {
+        mu_assert("test_mpsc: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+    }
+    init_object_for_select_api(&select_, list, 2, NULL);
+    pthread_create(&pid[0], NULL, (void *)helper_select, &select_);
+    usleep(10000);
+    mu_assert("test_mpsc: Select isn't blocked as expected", select_.out == GEN_ERROR);
+    mu_assert("test_mpsc: Testing channel receive", channel_receive(channel, &data) == SUCCESS);
+    pthread_join(pid[0], NULL);
+    mu_assert("test_mpsc: Select should send to the MPSC channel", select_.out == SUCCESS && select_.index == 1);
+    for (size_t i = 0; i < capacity; i++) {
+        mu_assert("test_mpsc: Testing channel receive",
+                  channel_receive(channel, &data) == SUCCESS && string_equal(data, "Message"));
+    }
+    mu_assert("test_mpsc: Can't close channel", channel_close(other) == SUCCESS);
+    mu_assert("test_mpsc: Can't destroy channel", channel_destroy(other) == SUCCESS);
+
+    /* Non-blocking calls report empty and full like a regular channel */
+    mu_assert("test_mpsc: Testing non blocking receive on empty channel", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+    for (size_t i = 0; i < capacity; i++) {
+        mu_assert("test_mpsc: Testing non blocking send", channel_non_blocking_send(channel, "Message") == SUCCESS);
+    }
+    mu_assert("test_mpsc: Testing non blocking send on full channel", channel_non_blocking_send(channel, "Message") == CHANNEL_FULL);
+    mu_assert("test_mpsc: Buffer size is not as expected", buffer_current_size(channel->buffer) == capacity);
+
+    mu_assert("test_mpsc: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_mpsc: Receive on closed channel should return CLOSED_ERROR", channel_receive(channel, &data) == CLOSED_ERROR);
+    mu_assert("test_mpsc: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    /* A producer that stalls after claiming the last free position, as if preempted inside
+     * buffer_mpsc_add, is played by hand. While it stalls the other producers find the buffer
+     * full at once instead of waiting, and once the consumer frees room they add behind it;
+     * the consumer reads up to the stalled position and then finds the buffer empty until the
+     * producer publishes, after which every value comes out in position order
+     */
+    buffer_t* buffer = buffer_create(capacity);
+    mu_assert("test_mpsc: Could not create buffer", buffer != NULL);
+    for (size_t i = 1; i < capacity; i++) {
+        mu_assert("test_mpsc: Testing buffer add", buffer_mpsc_add(buffer, (void*)i) == BUFFER_SUCCESS);
+    }
+    atomic_fetch_add(&buffer->reserved, 1);
+    size_t stalled = atomic_fetch_add(&buffer->tail, 1);
+    mu_assert("test_mpsc: Add to a buffer full up to a stalled producer should fail", buffer_mpsc_add(buffer, (void*)0) == BUFFER_ERROR);
+    for (size_t i = 1; i < capacity; i++) {
+        mu_assert("test_mpsc: Testing buffer remove", buffer_mpsc_remove(buffer, &data) == BUFFER_SUCCESS && (size_t)data == i);
+    }
+    mu_assert("test_mpsc: Stalled position should read as empty", buffer_mpsc_remove(buffer, &data) == BUFFER_ERROR);
+    for (size_t i = capacity + 1; i < 2 * capacity; i++) {
+        mu_assert("test_mpsc: Testing buffer add behind a stalled producer", buffer_mpsc_add(buffer, (void*)i) == BUFFER_SUCCESS);
+    }
+    mu_assert("test_mpsc: Add to a full buffer should fail", buffer_mpsc_add(buffer, (void*)0) == BUFFER_ERROR);
+    mu_assert("test_mpsc: Stalled position should read as empty", buffer_mpsc_remove(buffer, &data) == BUFFER_ERROR);
+    buffer->data[stalled & buffer->mask] = (void*)capacity;
+    atomic_store(&buffer->seq[stalled & buffer->mask], stalled + 1);
+    for (size_t i = capacity; i < 2 * capacity; i++) {
+        mu_assert("test_mpsc: Values were not removed in position order", buffer_mpsc_remove(buffer, &data) == BUFFER_SUCCESS && (size_t)data == i);
+    }
+    mu_assert("test_mpsc: Testing buffer remove on empty buffer", buffer_mpsc_remove(buffer, &data) == BUFFER_ERROR);
+    buffer_free(buffer);
+
+    return NULL;
+}
+
+char* test_send_receive_many() {
+    print_test_details(__func__, "Testing batched send and receive");
+
+    /* Non-blocking batches take as much as fits and wrap around the end of the buffer */
+    size_t capacity = 5;
+    channel_t* channel = channel_create(capacity);
+    mu_assert("test_send_receive_many: Could not create channel", channel != NULL);
+
+    void* items[8] = {(void*)1, (void*)2, (void*)3, (void*)4, (void*)5, (void*)6, (void*)7, (void*)8};
+    void* out[8];
+    size_t count = 0;
+    mu_assert("test_send_receive_many: Testing non blocking receive on empty channel",
+              channel_non_blocking_receive_many(channel, out, 8, &count) == CHANNEL_EMPTY && count == 0);
+    mu_assert("test_send_receive_many: Testing non blocking send",
+              channel_non_blocking_send_many(channel, items, 3, &count) == SUCCESS && count == 3);
+    mu_assert("test_send_receive_many: Testing non blocking receive",
+              channel_non_blocking_receive_many(channel, out, 2, &count) == SUCCESS && count == 2);
+    mu_assert("test_send_receive_many: Received wrong values", out[0] == items[0] && out[1] == items[1]);
+    mu_assert("test_send_receive_many: Testing non blocking send of more than fits",
+              channel_non_blocking_send_many(channel, items + 3, 5, &count) == SUCCESS && count == 4);
+    mu_assert("test_send_receive_many: Buffer size is not as expected", buffer_current_size(channel->buffer) == capacity);
+    mu_assert("test_send_receive_many: Testing non blocking send on full channel",
+              channel_non_blocking_send_many(channel, items + 7, 1, &count) == CHANNEL_FULL && count == 0);
+    mu_assert("test_send_receive_many: Testing blocking receive",
+              channel_receive_many(channel, out, 8, &count) == SUCCESS && count == capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        mu_assert("test_send_receive_many: Messages were not received in order", out[i] == items[i + 2]);
+    }
+
+    /* A blocked batch sender makes progress as the receiver drains the buffer */
+    size_t MESSAGES = 20000;
+    pthread_t pid;
+    sequence_args args;
+    init_object_for_sequence(&args, channel, 1, MESSAGES);
+    pthread_create(&pid, NULL, (void *)helper_send_sequence_many, &args);
+
+    size_t expected = 1;
+    while (expected <= MESSAGES) {
+        mu_assert("test_send_receive_many: Testing channel receive return failed",
+                  channel_receive_many(channel, out, 8, &count) == SUCCESS && count > 0);
+        for (size_t i = 0; i < count; i++) {
+            mu_assert("test_send_receive_many: Messages were not received in order", (size_t)out[i] == expected);
+            expected++;
+        }
+    }
+    pthread_join(pid, NULL);
+    mu_assert("test_send_receive_many: Testing channel send return failed", args.out == SUCCESS);
+
+    /* A batch that cannot finish reports how much was sent before the close */
+    init_object_for_sequence(&args, channel, 1, capacity + 3);
+    pthread_create(&pid, NULL, (void *)helper_send_sequence_many, &args);
+    /* args.out belongs to the sender until the join; a full buffer shows that it is blocked */
+    while (buffer_current_size(channel->buffer) < capacity) {
+        usleep(1000);
+    }
+    usleep(100000);
+    mu_assert("test_send_receive_many: Buffer size is not as expected", buffer_current_size(channel->buffer) == capacity);
+    mu_assert("test_send_receive_many: Can't close channel", channel_close(channel) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_send_receive_many: Blocked send should return CLOSED_ERROR", args.out == CLOSED_ERROR);
+    mu_assert("test_send_receive_many: Testing receive on closed channel",
+              channel_receive_many(channel, out, 8, &count) == CLOSED_ERROR && count == 0);
+    mu_assert("test_send_receive_many: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    return NULL;
+}
+
+char* test_wait_policies() {
+    print_test_details(__func__, "Testing the wait policies of blocking send and receive");
+
+    /* Each policy must deliver a sequence in order through a channel that keeps
+     * running full and empty, and must let a blocked send return on close
+     */
+    /* Plain channels park right away, spinning is opted into */
+    channel_t* plain = channel_create(1);
+    mu_assert("test_wait_policies: Default wait policy should block", plain->wait_policy == CHANNEL_WAIT_BLOCK);
+    mu_assert("test_wait_policies: Can't close channel", channel_close(plain) == SUCCESS);
+    mu_assert("test_wait_policies: Can't destroy channel", channel_destroy(plain) == SUCCESS);
+
+    enum channel_wait_policy policies[] = {CHANNEL_WAIT_BLOCK, CHANNEL_WAIT_SPIN, CHANNEL_WAIT_HYBRID, CHANNEL_WAIT_ADAPTIVE};
+    size_t MESSAGES = 5000;
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        channel_attr_t attr;
+        channel_attr_init(&attr);
+        attr.wait_policy = policies[p];
+        channel_t* channel = channel_create_attr(1, &attr);
+        mu_assert("test_wait_policies: Could not create channel", channel != NULL);
+        mu_assert("test_wait_policies: Wait policy is not as expected", channel->wait_policy == policies[p]);
+
+        pthread_t pid;
+        sequence_args args;
+        init_object_for_sequence(&args, channel, 1, MESSAGES);
+        pthread_create(&pid, NULL, (void *)helper_send_sequence, &args);
+        for (size_t i = 1; i <= MESSAGES; i++) {
+            void* data = NULL;
+            mu_assert("test_wait_policies: Testing channel receive return failed", channel_receive(channel, &data) == SUCCESS);
+            mu_assert("test_wait_policies: Messages were not received in order", (size_t)data == i);
+        }
+        pthread_join(pid, NULL);
+        mu_assert("test_wait_policies: Testing channel send return failed", args.out == SUCCESS);
+
+        mu_assert("test_wait_policies: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+        send_args send_;
+        init_object_for_send_api(&send_, channel, "Message", NULL);
+        pthread_create(&pid, NULL, (void *)helper_send, &send_);
+        usleep(100000);
+        mu_assert("test_wait_policies: It isn't blocked as expected", send_.out == GEN_ERROR);
+        mu_assert("test_wait_policies: Can't close channel", channel_close(channel) == SUCCESS);
+        pthread_join(pid, NULL);
+        mu_assert("test_wait_policies: Blocked send should return CLOSED_ERROR", send_.out == CLOSED_ERROR);
+        mu_assert("test_wait_policies: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    }
+
+    return NULL;
+}
+
+char* test_timed() {
+    print_test_details(__func__, "Testing timed send, receive and select");
+
+    /* Timed calls give up at the deadline, and only then */
+    uint64_t WAIT = convertSecondsToTime(0.05);
+    struct timespec deadline;
+    void* data = NULL;
+    size_t index = 0;
+    channel_t* buffered = channel_create(1);
+    channel_t* unbuffered = channel_create(0);
+
+    uint64_t t = getTime();
+    convertTimeToTimespec(t + WAIT, &deadline);
+    mu_assert("test_timed: Receive on empty channel should time out", channel_receive_timed(buffered, &data, &deadline) == TIMEOUT);
+    mu_assert("test_timed: Receive returned before the deadline", getTime() - t >= WAIT);
+    mu_assert("test_timed: Testing channel send", channel_send_timed(buffered, "Message", &deadline) == SUCCESS);
+
+    t = getTime();
+    convertTimeToTimespec(t + WAIT, &deadline);
+    mu_assert("test_timed: Send on full channel should time out", channel_send_timed(buffered, "Message", &deadline) == TIMEOUT);
+    mu_assert("test_timed: Send returned before the deadline", getTime() - t >= WAIT);
+
+    /* A deadline in the past still performs an operation that is ready */
+    convertTimeToTimespec(t, &deadline);
+    mu_assert("test_timed: Receive on non-empty channel should succeed",
+              channel_receive_timed(buffered, &data, &deadline) == SUCCESS && string_equal(data, "Message"));
+
+    /* An unbuffered receive that timed out can no longer be handed a value */
+    t = getTime();
+    convertTimeToTimespec(t + WAIT, &deadline);
+    mu_assert("test_timed: Unbuffered receive should time out", channel_receive_timed(unbuffered, &data, &deadline) == TIMEOUT);
+    mu_assert("test_timed: Unbuffered receive returned before the deadline", getTime() - t >= WAIT);
+    mu_assert("test_timed: No receiver should be waiting", channel_non_blocking_send(unbuffered, "Message") == CHANNEL_FULL);
+
+    select_t list[2] = {{buffered, RECV, NULL}, {unbuffered, RECV, NULL}};
+    t = getTime();
+    convertTimeToTimespec(t + WAIT, &deadline);
+    mu_assert("test_timed: Select should time out", channel_select_timed(list, 2, &index, &deadline) == TIMEOUT);
+    mu_assert("test_timed: Select returned before the deadline", getTime() - t >= WAIT);
+    mu_assert("test_timed: Select on an empty list should fail", channel_select(list, 0, &index) == GEN_ERROR);
+    mu_assert("test_timed: Timed select on an empty list should fail",
+              channel_select_timed(list, 0, &index, &deadline) == GEN_ERROR);
+
+    /* A waiting timed call completes as soon as its counterpart arrives */
+    pthread_t pid;
+    send_args send_;
+    init_object_for_send_api(&send_, unbuffered, "Unbuffered", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    convertTimeToTimespec(getTime() + convertSecondsToTime(5), &deadline);
+    mu_assert("test_timed: Select should receive from the sender",
+              channel_select_timed(list, 2, &index, &deadline) == SUCCESS && index == 1 && string_equal(list[1].data, "Unbuffered"));
+    pthread_join(pid, NULL);
+    mu_assert("test_timed: Testing channel send return failed", send_.out == SUCCESS);
+
+    init_object_for_send_api(&send_, buffered, "Buffered", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    mu_assert("test_timed: Receive should get the message",
+              channel_receive_timed(buffered, &data, &deadline) == SUCCESS && string_equal(data, "Buffered"));
+    pthread_join(pid, NULL);
+
+    mu_assert("test_timed: Can't close channel", channel_close(buffered) == SUCCESS);
+    mu_assert("test_timed: Can't close channel", channel_close(unbuffered) == SUCCESS);
+    mu_assert("test_timed: Receive on closed channel should return CLOSED_ERROR", channel_receive_timed(buffered, &data, &deadline) == CLOSED_ERROR);
+    mu_assert("test_timed: Send on closed channel should return CLOSED_ERROR", channel_send_timed(unbuffered, "Message", &deadline) == CLOSED_ERROR);
+    mu_assert("test_timed: Can't destroy channel", channel_destroy(buffered) == SUCCESS);
+    mu_assert("test_timed: Can't destroy channel", channel_destroy(unbuffered) == SUCCESS);
+
+    return NULL;
+}
+
+char* test_buffer_layout() {
+    print_test_details(__func__, "Testing buffer capacity and wrap-around with power-of-two slots");
+
+    /* Capacities that are not powers of two still hold exactly capacity values,
+     * and values stay in order across many laps of the ring
+     */
+    size_t capacities[] = {1, 3, 5, 8, 100};
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        size_t capacity = capacities[c];
+        buffer_t* buffer = buffer_create(capacity);
+        mu_assert("test_buffer_layout: Could not create buffer", buffer != NULL);
+        mu_assert("test_buffer_layout: Buffer capacity is not as expected", buffer_capacity(buffer) == capacity);
+        mu_assert("test_buffer_layout: Slots are not aligned to the cache line", ((uintptr_t)buffer->data % BUFFER_CACHE_LINE) == 0);
+
+        size_t next_in = 1;
+        size_t next_out = 1;
+        void* data = NULL;
+        for (size_t lap = 0; lap < 10; lap++) {
+            while (buffer_add(buffer, (void*)next_in) == BUFFER_SUCCESS) {
+                next_in++;
+            }
+            mu_assert("test_buffer_layout: Buffer size is not as expected", buffer_current_size(buffer) == capacity);
+            for (size_t i = 0; i <= lap % capacity; i++) {
+                mu_assert("test_buffer_layout: Testing buffer remove", buffer_remove(buffer, &data) == BUFFER_SUCCESS);
+                mu_assert("test_buffer_layout: Values were not removed in order", (size_t)data == next_out);
+                next_out++;
+            }
+        }
+        while (buffer_remove(buffer, &data) == BUFFER_SUCCESS) {
+            mu_assert("test_buffer_layout: Values were not removed in order", (size_t)data == next_out);
+            next_out++;
+        }
+        mu_assert("test_buffer_layout: Values were lost", next_out == next_in);
+        buffer_free(buffer);
+    }
+
+    return NULL;
+}
+
+char* test_stats() {
+    print_test_details(__func__, "Testing channel statistics");
+
+    channel_t* channel = channel_create(2);
+    channel_stats_t stats;
+#ifndef CHANNEL_STATS
+    /* Without CHANNEL_STATS there is nothing to report */
+    mu_assert("test_stats: Stats should not be available", channel_get_stats(channel, &stats) == GEN_ERROR);
+#else
+    void* data = NULL;
+    mu_assert("test_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_stats: New channel should have no sends", stats.sends == 0 && stats.receives == 0);
+
+    /* Every operation and every non-blocking failure is counted */
+    mu_assert("test_stats: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+    mu_assert("test_stats: Testing channel send", channel_non_blocking_send(channel, "Message") == SUCCESS);
+    mu_assert("test_stats: Testing non blocking send on full channel", channel_non_blocking_send(channel, "Message") == CHANNEL_FULL);
+    mu_assert("test_stats: Testing channel receive", channel_receive(channel, &data) == SUCCESS);
+    mu_assert("test_stats: Testing channel receive", channel_non_blocking_receive(channel, &data) == SUCCESS);
+    mu_assert("test_stats: Testing non blocking receive on empty channel", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+    mu_assert("test_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_stats: Sends are not as expected", stats.sends == 2);
+    mu_assert("test_stats: Receives are not as expected", stats.receives == 2);
+    mu_assert("test_stats: Full sends are not as expected", stats.send_full == 1);
+    mu_assert("test_stats: Empty receives are not as expected", stats.receive_empty == 1);
+    mu_assert("test_stats: Peak size is not as expected", stats.peak_size == 2);
+    mu_assert("test_stats: Nothing should have parked", stats.send_parks == 0 && stats.receive_parks == 0);
+
+    /* A receiver that has to wait parks once and is woken by the send */
+    pthread_t pid;
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, channel, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(100000);
+    mu_assert("test_stats: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_stats: Testing channel receive return failed", receive_.out == SUCCESS);
+    mu_assert("test_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_stats: Receive parks are not as expected", stats.receive_parks == 1);
+    mu_assert("test_stats: Parked time is not as expected", stats.parked_ns >= 50000000);
+    mu_assert("test_stats: Wakeups are not as expected", stats.wakeups == 1 && stats.wakeups_with_work == 1);
+
+    /* A select woken by a send counts as a wakeup as well */
+    sem_t done;
+    sem_init(&done, 0, 0);
+    select_t list[1] = {{.dir = RECV, .channel = channel}};
+    select_args select_;
+    init_object_for_select_api(&select_, list, 1, &done);
+    pthread_create(&pid, NULL, (void *)helper_select, &select_);
+    usleep(100000);
+    mu_assert("test_stats: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+    sem_wait(&done);
+    pthread_join(pid, NULL);
+    sem_destroy(&done);
+    mu_assert("test_stats: Testing select return failed", select_.out == SUCCESS && select_.index == 0);
+    mu_assert("test_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_stats: Select wakeups are not counted", stats.wakeups == 2);
+#endif
+
+    mu_assert("test_stats: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_stats: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
+char* test_lock_stats() {
+    print_test_details(__func__, "Testing the lock profile of channel statistics");
+
+    channel_t* channel = channel_create(0);
+    channel_stats_t stats;
+#ifndef CHANNEL_STATS
+    /* Without CHANNEL_STATS there is nothing to report */
+    mu_assert("test_lock_stats: Stats should not be available", channel_get_stats(channel, &stats) == GEN_ERROR);
+    mu_assert("test_lock_stats: Can't close channel", channel_close(channel) == SUCCESS);
+#else
+    /* A non-blocking send without a receiver looks for one under the lock */
+    mu_assert("test_lock_stats: Testing non blocking send without receiver", channel_non_blocking_send(channel, "Message") == CHANNEL_FULL);
+    mu_assert("test_lock_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_lock_stats: Non-blocking acquisitions are not as expected", stats.locks[CHANNEL_SITE_NON_BLOCKING].acquisitions == 1);
+    mu_assert("test_lock_stats: Uncontended lock should not wait", stats.locks[CHANNEL_SITE_NON_BLOCKING].contended == 0 && stats.locks[CHANNEL_SITE_NON_BLOCKING].wait_ns == 0);
+    mu_assert("test_lock_stats: Nothing else should have locked", stats.locks[CHANNEL_SITE_SEND].acquisitions == 0 && stats.locks[CHANNEL_SITE_SELECT].acquisitions == 0);
+
+    /* A blocked receive registers and unregisters under the receive site, the select that meets it under its own */
+    pthread_t pid;
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, channel, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(100000);
+    select_t list[] = {{ channel, SEND, "Message" }};
+    size_t index;
+    mu_assert("test_lock_stats: Testing channel select", channel_select(list, 1, &index) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_lock_stats: Testing channel receive return failed", receive_.out == SUCCESS);
+    mu_assert("test_lock_stats: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_lock_stats: Can't get stats", channel_get_stats(channel, &stats) == SUCCESS);
+    mu_assert("test_lock_stats: Receive acquisitions are not as expected", stats.locks[CHANNEL_SITE_RECEIVE].acquisitions >= 3);
+    mu_assert("test_lock_stats: Select acquisitions are not as expected", stats.locks[CHANNEL_SITE_SELECT].acquisitions >= 1);
+    mu_assert("test_lock_stats: Close acquisitions are not as expected", stats.locks[CHANNEL_SITE_CLOSE].acquisitions == 1);
+    uint64_t hold_ns = 0;
+    for(size_t site = 0; site < CHANNEL_SITES; site++){
+        mu_assert("test_lock_stats: More contended than total acquisitions", stats.locks[site].contended <= stats.locks[site].acquisitions);
+        hold_ns += stats.locks[site].hold_ns;
+    }
+    mu_assert("test_lock_stats: Hold time was not measured", hold_ns > 0);
+
+    /* A select set between selects costs the sends and receives on its channels no lock */
+    channel_t* watched = channel_create(1);
+    select_set_t* set = select_set_create();
+    size_t id;
+    mu_assert("test_lock_stats: Can't add entry", select_set_add(set, watched, RECV, NULL, &id) == SUCCESS);
+    mu_assert("test_lock_stats: Testing channel send", channel_send(watched, "Message") == SUCCESS);
+    void* data = NULL;
+    mu_assert("test_lock_stats: Testing channel receive", channel_receive(watched, &data) == SUCCESS);
+    mu_assert("test_lock_stats: Can't get stats", channel_get_stats(watched, &stats) == SUCCESS);
+    mu_assert("test_lock_stats: Idle set should not be notified",
+              stats.locks[CHANNEL_SITE_SEND].acquisitions == 0 && stats.locks[CHANNEL_SITE_RECEIVE].acquisitions == 0);
+    select_set_destroy(set);
+    mu_assert("test_lock_stats: Can't close channel", channel_close(watched) == SUCCESS);
+    mu_assert("test_lock_stats: Can't destroy channel", channel_destroy(watched) == SUCCESS);
+#endif
+
+    mu_assert("test_lock_stats: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
+// Reads the whole file into a newly allocated string
+char* read_file(FILE* file) {
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* contents = malloc((size_t)size + 1);
+    size_t read = fread(contents, 1, (size_t)size, file);
+    contents[read] = '\0';
+    return contents;
+}
+
+char* test_registry() {
+    print_test_details(__func__, "Testing the channel registry and its exports");
+
+    /* Created channels show up in the registry until they are destroyed */
+    size_t count = channel_registry_count();
+    channel_attr_t attr;
+    channel_attr_init(&attr);
+    attr.name = "stage \"one\"";
+    channel_t* named = channel_create_attr(7, &attr);
+    channel_t* unnamed = channel_create(3);
+    mu_assert("test_registry: Channels were not registered", channel_registry_count() == count + 2);
+    mu_assert("test_registry: Testing channel send", channel_send(named, "Message") == SUCCESS);
+    mu_assert("test_registry: Can't close channel", channel_close(unnamed) == SUCCESS);
+
+    /* The JSON snapshot carries every field, with the name escaped */
+    FILE* file = tmpfile();
+    mu_assert("test_registry: Can't export JSON", channel_registry_export(fileno(file), CHANNEL_EXPORT_JSON) == SUCCESS);
+    char* json = read_file(file);
+    fclose(file);
+    mu_assert("test_registry: JSON is missing the named channel",
+              strstr(json, "\"name\":\"stage \\\"one\\\"\",\"capacity\":7,\"size\":1,\"send_waiters\":0,\"recv_waiters\":0,\"closed\":false}") != NULL);
+    mu_assert("test_registry: JSON is missing the unnamed channel",
+              strstr(json, "\"name\":null,\"capacity\":3,\"size\":0,\"send_waiters\":0,\"recv_waiters\":0,\"closed\":true}") != NULL);
+    char expected[64];
+    snprintf(expected, sizeof(expected), "{\"id\":%u,\"name\":null,", (unsigned)unnamed->id);
+    mu_assert("test_registry: JSON is missing the channel id", strstr(json, expected) != NULL);
+    free(json);
+
+    /* Renaming shows up in the next snapshot; label values only escape \\, \" and newlines */
+    mu_assert("test_registry: Can't set name", channel_set_name(unnamed, "stage\ttwo") == SUCCESS);
+    char path[] = "/tmp/channel_registry_XXXXXX";
+    int fd = mkstemp(path);
+    mu_assert("test_registry: Can't create file", fd >= 0);
+    close(fd);
+    mu_assert("test_registry: Can't export Prometheus text", channel_registry_export_path(path, CHANNEL_EXPORT_PROMETHEUS) == SUCCESS);
+    file = fopen(path, "r");
+    char* text = read_file(file);
+    fclose(file);
+    unlink(path);
+    mu_assert("test_registry: Prometheus text is missing the metric type", strstr(text, "# TYPE channel_size gauge\n") != NULL);
+    mu_assert("test_registry: Prometheus text is missing the named channel", strstr(text, "channel_capacity{name=\"stage \\\"one\\\"\"") != NULL);
+    snprintf(expected, sizeof(expected), "channel_closed{name=\"stage\ttwo\",id=\"%u\"} 1\n", (unsigned)unnamed->id);
+    mu_assert("test_registry: Prometheus text is missing the renamed channel", strstr(text, expected) != NULL);
+    free(text);
+
+    mu_assert("test_registry: Can't close channel", channel_close(named) == SUCCESS);
+    mu_assert("test_registry: Can't destroy channel", channel_destroy(named) == SUCCESS);
+    mu_assert("test_registry: Can't destroy channel", channel_destroy(unnamed) == SUCCESS);
+    mu_assert("test_registry: Channels were not removed from the registry", channel_registry_count() == count);
+    return NULL;
+}
+
+char* test_latency() {
+    print_test_details(__func__, "Testing sojourn time histograms");
+
+    channel_latency_t latency;
+    channel_t* plain = channel_create(10);
+    mu_assert("test_latency: Channel should not record latency", channel_get_latency(plain, &latency) == GEN_ERROR);
+
+    /* Values that sit in the buffer for 20ms are reported at about 20ms */
+    channel_attr_t attr;
+    channel_attr_init(&attr);
+    attr.record_latency = true;
+    channel_t* channel = channel_create_attr(10, &attr);
+    mu_assert("test_latency: Can't get latency", channel_get_latency(channel, &latency) == SUCCESS);
+    mu_assert("test_latency: New channel should have no samples", latency.count == 0 && latency.max_ns == 0);
+
+    void* items[5] = {"1", "2", "3", "4", "5"};
+    void* out[5];
+    size_t count = 0;
+    for (size_t i = 0; i < 5; i++) {
+        mu_assert("test_latency: Testing channel send", channel_send(channel, items[i]) == SUCCESS);
+    }
+    usleep(20000);
+    for (size_t i = 0; i < 5; i++) {
+        mu_assert("test_latency: Testing channel receive", channel_receive(channel, &out[i]) == SUCCESS);
+    }
+    mu_assert("test_latency: Testing batched send", channel_send_many(channel, items, 5, &count) == SUCCESS);
+    usleep(20000);
+    mu_assert("test_latency: Testing batched receive", channel_receive_many(channel, out, 5, &count) == SUCCESS && count == 5);
+
+    mu_assert("test_latency: Can't get latency", channel_get_latency(channel, &latency) == SUCCESS);
+    mu_assert("test_latency: Sample count is not as expected", latency.count == 10);
+    mu_assert("test_latency: Median is not as expected", latency.p50_ns >= 15000000 && latency.p50_ns < 1000000000);
+    mu_assert("test_latency: Percentiles are not ordered",
+              latency.p50_ns <= latency.p99_ns && latency.p99_ns <= latency.p999_ns && latency.p999_ns <= latency.max_ns);
+    mu_assert("test_latency: Max is not as expected", latency.max_ns < 1000000000);
+
+    /* Values a lossy channel drops were never received and record no sojourn time */
+    attr.kind = CHANNEL_LOSSY;
+    channel_t* lossy = channel_create_attr(2, &attr);
+    for (size_t i = 0; i < 5; i++) {
+        mu_assert("test_latency: Testing lossy send", channel_non_blocking_send(lossy, items[i]) == SUCCESS);
+    }
+    uint64_t dropped = 0;
+    mu_assert("test_latency: Can't get dropped", channel_get_dropped(lossy, &dropped) == SUCCESS && dropped == 3);
+    mu_assert("test_latency: Can't get latency", channel_get_latency(lossy, &latency) == SUCCESS);
+    mu_assert("test_latency: Drops should not be sampled", latency.count == 0);
+    mu_assert("test_latency: Testing lossy receive", channel_receive(lossy, &out[0]) == SUCCESS && string_equal(out[0], "4"));
+    mu_assert("test_latency: Can't get latency", channel_get_latency(lossy, &latency) == SUCCESS);
+    mu_assert("test_latency: Sample count is not as expected", latency.count == 1);
+
+    mu_assert("test_latency: Can't close channel", channel_close(lossy) == SUCCESS);
+    mu_assert("test_latency: Can't destroy channel", channel_destroy(lossy) == SUCCESS);
+    mu_assert("test_latency: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_latency: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    mu_assert("test_latency: Can't close channel", channel_close(plain) == SUCCESS);
+    mu_assert("test_latency: Can't destroy channel", channel_destroy(plain) == SUCCESS);
+    return NULL;
+}
+
+// Dumps the trace into a temporary file and reads its header and events
+// Returns the events, which the caller frees, or NULL if the dump could not be read back
+channel_trace_event_t* read_trace(channel_trace_header_t* header) {
+    FILE* file = tmpfile();
+    channel_trace_event_t* events = NULL;
+    if (channel_trace_dump(fileno(file)) == SUCCESS) {
+        fseek(file, 0, SEEK_SET);
+        if (fread(header, sizeof(*header), 1, file) == 1) {
+            events = malloc(sizeof(channel_trace_event_t) * (header->count + 1));
+            if (fread(events, sizeof(channel_trace_event_t), header->count, file) != header->count) {
+                free(events);
+                events = NULL;
+            }
+        }
+    }
+    fclose(file);
+    return events;
+}
+
+char* test_trace() {
+    print_test_details(__func__, "Testing the binary event trace");
+
+    /* A thread's ring keeps its newest events, oldest first */
+    channel_trace_reset();
+    for (size_t i = 0; i < CHANNEL_TRACE_RING_SIZE + 3; i++) {
+        channel_trace_record(7, CHANNEL_TRACE_SEND, (int)(i % 100));
+    }
+    channel_trace_record(7, CHANNEL_TRACE_WAKE, 1000);
+    channel_trace_header_t header;
+    channel_trace_event_t* events = read_trace(&header);
+    mu_assert("test_trace: Can't read the trace", events != NULL);
+    mu_assert("test_trace: Magic is not as expected", memcmp(header.magic, CHANNEL_TRACE_MAGIC, sizeof(header.magic)) == 0);
+    mu_assert("test_trace: Event count is not as expected", header.count == CHANNEL_TRACE_RING_SIZE);
+    mu_assert("test_trace: Oldest event is not as expected", events[0].outcome == 4 && events[0].channel == 7);
+    mu_assert("test_trace: Events are not in order", events[0].time <= events[1].time && events[0].thread == events[1].thread);
+    mu_assert("test_trace: Newest event is not as expected", events[header.count - 1].op == CHANNEL_TRACE_WAKE);
+    mu_assert("test_trace: Outcome was not clamped", events[header.count - 1].outcome == INT8_MAX);
+    free(events);
+
+#ifdef CHANNEL_TRACE
+    /* A receiver that has to wait records its park, the send its wakeup, and both their completion */
+    channel_trace_reset();
+    channel_t* channel = channel_create(1);
+    pthread_t pid;
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, channel, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(100000);
+    mu_assert("test_trace: Testing channel send", channel_send(channel, "Message") == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_trace: Testing channel receive return failed", receive_.out == SUCCESS);
+    events = read_trace(&header);
+    mu_assert("test_trace: Can't read the trace", events != NULL);
+    bool park = false, unpark = false, wake = false, send = false, receive = false;
+    for (size_t i = 0; i < header.count; i++) {
+        mu_assert("test_trace: Event has the wrong channel", events[i].channel == channel->id);
+        park = park || events[i].op == CHANNEL_TRACE_RECEIVE_PARK;
+        unpark = unpark || (events[i].op == CHANNEL_TRACE_UNPARK && events[i].outcome == SUCCESS);
+        wake = wake || (events[i].op == CHANNEL_TRACE_WAKE && events[i].outcome == 1);
+        send = send || (events[i].op == CHANNEL_TRACE_SEND && events[i].outcome == SUCCESS);
+        receive = receive || (events[i].op == CHANNEL_TRACE_RECEIVE && events[i].outcome == SUCCESS);
+    }
+    free(events);
+    mu_assert("test_trace: Park was not traced", park && unpark);
+    mu_assert("test_trace: Wakeup was not traced", wake);
+    mu_assert("test_trace: Completions were not traced", send && receive);
+    mu_assert("test_trace: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_trace: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+#endif
+
+    channel_trace_reset();
+    return NULL;
+}
+
+char* test_select_fairness() {
+    print_test_details(__func__, "Testing fair orders of channel select");
+
+    channel_t* channels[3];
+    select_t list[3];
+    for (size_t i = 0; i < 3; i++) {
+        channels[i] = channel_create(30);
+        for (size_t j = 0; j < 30; j++) {
+            mu_assert("test_select_fairness: Testing channel send", channel_send(channels[i], "Message") == SUCCESS);
+        }
+        list[i].channel = channels[i];
+        list[i].dir = RECV;
+    }
+    size_t index;
+    size_t counts[3] = {0, 0, 0};
+
+    /* First-ready keeps taking the first entry while it is ready */
+    channel_select_fairness_t fairness;
+    channel_select_fairness_init(&fairness, CHANNEL_SELECT_FIRST_READY);
+    for (size_t i = 0; i < 3; i++) {
+        mu_assert("test_select_fairness: Testing channel select", channel_select_fair(list, 3, &index, &fairness, NULL) == SUCCESS);
+        mu_assert("test_select_fairness: First-ready should select the first entry", index == 0);
+    }
+
+    /* Round-robin takes turns among the ready entries */
+    channel_select_fairness_init(&fairness, CHANNEL_SELECT_ROUND_ROBIN);
+    for (size_t i = 0; i < 9; i++) {
+        mu_assert("test_select_fairness: Testing channel select", channel_select_fair(list, 3, &index, &fairness, NULL) == SUCCESS);
+        mu_assert("test_select_fairness: Round-robin is out of turn", index == i % 3);
+    }
+
+    /* Once an entry is not ready anymore, round-robin skips it */
+    void* data = NULL;
+    while (channel_non_blocking_receive(channels[1], &data) == SUCCESS) {
+    }
+    for (size_t i = 0; i < 4; i++) {
+        mu_assert("test_select_fairness: Testing channel select", channel_select_fair(list, 3, &index, &fairness, NULL) == SUCCESS);
+        mu_assert("test_select_fairness: Round-robin selected an empty channel", index == (i % 2 == 0 ? 0 : 2));
+    }
+
+    /* Random eventually selects every ready entry */
+    mu_assert("test_select_fairness: Testing channel send", channel_send(channels[1], "Message") == SUCCESS);
+    channel_select_fairness_init(&fairness, CHANNEL_SELECT_RANDOM);
+    for (size_t i = 0; i < 60; i++) {
+        mu_assert("test_select_fairness: Testing channel select", channel_select_fair(list, 3, &index, &fairness, NULL) == SUCCESS);
+        counts[index]++;
+        if (index == 1) {
+            mu_assert("test_select_fairness: Testing channel send", channel_send(channels[1], "Message") == SUCCESS);
+        }
+    }
+    mu_assert("test_select_fairness: Random did not select every entry", counts[0] > 0 && counts[1] > 0 && counts[2] > 0);
+    mu_assert("test_select_fairness: Missing fairness state", channel_select_fair(list, 3, &index, NULL, NULL) == GEN_ERROR);
+
+    /* Selects blocked on the same channel are handed the values one send at a time, so each
+     * send completes exactly one of them and none is left waiting while values are there */
+    size_t SELECTS = 4;
+    channel_t* shared = channel_create(SELECTS);
+    pthread_t pid[SELECTS];
+    select_t shared_list[SELECTS][1];
+    select_args args[SELECTS];
+    sem_t done;
+    sem_init(&done, 0, 0);
+    for (size_t i = 0; i < SELECTS; i++) {
+        shared_list[i][0] = (select_t){ shared, RECV, NULL };
+        init_object_for_select_api(&args[i], shared_list[i], 1, &done);
+        pthread_create(&pid[i], NULL, (void *)helper_select, &args[i]);
+    }
+    usleep(10000);
+    for (size_t i = 0; i < SELECTS; i++) {
+        mu_assert("test_select_fairness: Testing channel send", channel_send(shared, "Shared") == SUCCESS);
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += 5;
+        mu_assert("test_select_fairness: Blocked select was not woken", sem_timedwait(&done, &deadline) == 0);
+    }
+    for (size_t i = 0; i < SELECTS; i++) {
+        pthread_join(pid[i], NULL);
+        mu_assert("test_select_fairness: Select failed", args[i].out == SUCCESS && string_equal(shared_list[i][0].data, "Shared"));
+    }
+    sem_destroy(&done);
+    mu_assert("test_select_fairness: Can't close channel", channel_close(shared) == SUCCESS);
+    mu_assert("test_select_fairness: Can't destroy channel", channel_destroy(shared) == SUCCESS);
+
+    for (size_t i = 0; i < 3; i++) {
+        mu_assert("test_select_fairness: Can't close channel", channel_close(channels[i]) == SUCCESS);
+        mu_assert("test_select_fairness: Can't destroy channel", channel_destroy(channels[i]) == SUCCESS);
+    }
+    return NULL;
+}
+
+char* test_select_non_blocking() {
+    print_test_details(__func__, "Testing non-blocking channel select");
+
+    channel_t* first = channel_create(1);
+    channel_t* second = channel_create(1);
+    channel_t* unbuffered = channel_create(0);
+    select_t list[] = {{ first, RECV, NULL }, { second, RECV, NULL }, { unbuffered, SEND, "Unbuffered" }};
+    size_t index = 42;
+
+    /* Nothing ready: returns right away without touching selected_index */
+    mu_assert("test_select_non_blocking: Empty list should not be ready", channel_select_non_blocking(list, 0, &index) == CHANNEL_EMPTY);
+    mu_assert("test_select_non_blocking: Nothing should be ready", channel_select_non_blocking(list, 3, &index) == CHANNEL_EMPTY);
+    mu_assert("test_select_non_blocking: Index should be untouched", index == 42);
+
+    /* The first ready entry is performed */
+    mu_assert("test_select_non_blocking: Testing channel send", channel_send(second, "Second") == SUCCESS);
+    mu_assert("test_select_non_blocking: Testing select receive", channel_select_non_blocking(list, 3, &index) == SUCCESS);
+    mu_assert("test_select_non_blocking: Wrong entry selected", index == 1 && string_equal(list[1].data, "Second"));
+    mu_assert("test_select_non_blocking: Channel should be empty again", channel_select_non_blocking(list, 3, &index) == CHANNEL_EMPTY);
+
+    /* An unbuffered entry succeeds once a receiver is blocked on the channel */
+    pthread_t pid;
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, unbuffered, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(100000);
+    mu_assert("test_select_non_blocking: Testing select send", channel_select_non_blocking(list, 3, &index) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_non_blocking: Wrong entry selected", index == 2);
+    mu_assert("test_select_non_blocking: Testing channel receive return failed", receive_.out == SUCCESS && string_equal(receive_.data, "Unbuffered"));
+
+    /* Errors are reported with the entry that caused them */
+    mu_assert("test_select_non_blocking: Can't close channel", channel_close(second) == SUCCESS);
+    mu_assert("test_select_non_blocking: Testing select on closed channel", channel_select_non_blocking(list, 3, &index) == CLOSED_ERROR);
+    mu_assert("test_select_non_blocking: Wrong entry selected", index == 1);
+    mu_assert("test_select_non_blocking: Missing index", channel_select_non_blocking(list, 3, NULL) == GEN_ERROR);
+
+    mu_assert("test_select_non_blocking: Can't close channel", channel_close(first) == SUCCESS);
+    mu_assert("test_select_non_blocking: Can't close channel", channel_close(unbuffered) == SUCCESS);
+    mu_assert("test_select_non_blocking: Can't destroy channel", channel_destroy(first) == SUCCESS);
+    mu_assert("test_select_non_blocking: Can't destroy channel", channel_destroy(second) == SUCCESS);
+    mu_assert("test_select_non_blocking: Can't destroy channel", channel_destroy(unbuffered) == SUCCESS);
+    return NULL;
+}
+
+char* test_select_set() {
+    print_test_details(__func__, "Testing prepared select sets");
+
+    channel_t* in = channel_create(1);
+    channel_t* out = channel_create(1);
+    channel_t* unbuffered = channel_create(0);
+    select_set_t* set = select_set_create();
+    mu_assert("test_select_set: Can't create set", set != NULL);
+
+    size_t id_in, id_out, id_unbuffered, selected = 42;
+    mu_assert("test_select_set: Can't add entry", select_set_add(set, in, RECV, NULL, &id_in) == SUCCESS);
+    mu_assert("test_select_set: Can't add entry", select_set_add(set, out, SEND, "Out", &id_out) == SUCCESS);
+    mu_assert("test_select_set: Missing id", select_set_add(set, in, RECV, NULL, NULL) == GEN_ERROR);
+    mu_assert("test_select_set: Ids should differ", id_in != id_out);
+
+    struct timespec deadline;
+    uint64_t WAIT = convertSecondsToTime(0.05);
+
+    /* The ready entry is performed, then nothing is ready until the deadline */
+    mu_assert("test_select_set: Testing select send", channel_select_set(set, &selected, NULL) == SUCCESS);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_out);
+    convertTimeToTimespec(getTime() + WAIT, &deadline);
+    mu_assert("test_select_set: Testing select timeout", channel_select_set(set, &selected, &deadline) == TIMEOUT);
+    void* data = NULL;
+    mu_assert("test_select_set: Testing channel receive", channel_receive(out, &data) == SUCCESS && string_equal(data, "Out"));
+
+    /* Disabled entries are skipped, the router pattern: disable the outputs that are done */
+    mu_assert("test_select_set: Can't disable entry", select_set_disable(set, id_out) == SUCCESS);
+    mu_assert("test_select_set: Testing channel send", channel_send(in, "In") == SUCCESS);
+    mu_assert("test_select_set: Can't disable entry", select_set_disable(set, id_in) == SUCCESS);
+    convertTimeToTimespec(getTime() + WAIT, &deadline);
+    mu_assert("test_select_set: Disabled entries should time out", channel_select_set(set, &selected, &deadline) == TIMEOUT);
+    mu_assert("test_select_set: Can't enable entry", select_set_enable(set, id_in) == SUCCESS);
+    mu_assert("test_select_set: Testing select receive", channel_select_set(set, &selected, NULL) == SUCCESS);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_in && string_equal(select_set_entry(set, id_in)->data, "In"));
+
+    /* A waiting select is woken by a send on a registered channel */
+    pthread_t pid;
+    send_args send_;
+    init_object_for_send_api(&send_, in, "Later", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    mu_assert("test_select_set: Testing blocked select", channel_select_set(set, &selected, NULL) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_in && string_equal(select_set_entry(set, id_in)->data, "Later"));
+
+    /* An idle set can't be completed by a rendezvous, a waiting one can */
+    mu_assert("test_select_set: Can't add entry", select_set_add(set, unbuffered, RECV, NULL, &id_unbuffered) == SUCCESS);
+    mu_assert("test_select_set: Idle set should not take a value", channel_non_blocking_send(unbuffered, "Idle") == CHANNEL_FULL);
+    init_object_for_send_api(&send_, unbuffered, "Rendezvous", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    mu_assert("test_select_set: Testing unbuffered select", channel_select_set(set, &selected, NULL) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_unbuffered && send_.out == SUCCESS &&
+              string_equal(select_set_entry(set, id_unbuffered)->data, "Rendezvous"));
+    usleep(10000);
+    init_object_for_send_api(&send_, unbuffered, "Blocked", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    usleep(100000);
+    mu_assert("test_select_set: Testing select with a blocked sender", channel_select_set(set, &selected, NULL) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_unbuffered && send_.out == SUCCESS &&
+              string_equal(select_set_entry(set, id_unbuffered)->data, "Blocked"));
+
+    /* Entries must fit their channel, and an entry that fails leaves the set idle */
+    channel_t* broadcast = channel_create_broadcast(1);
+    channel_t* subscription = channel_subscribe(broadcast);
+    channel_t* typed = channel_create_typed(1, sizeof(int));
+    int value = 0;
+    size_t id_typed;
+    mu_assert("test_select_set: Testing receive from broadcast", select_set_add(set, broadcast, RECV, NULL, &id_typed) == GEN_ERROR);
+    mu_assert("test_select_set: Testing send to subscription", select_set_add(set, subscription, SEND, "X", &id_typed) == GEN_ERROR);
+    mu_assert("test_select_set: Testing typed entry without data", select_set_add(set, typed, RECV, NULL, &id_typed) == GEN_ERROR);
+    mu_assert("test_select_set: Testing invalid direction", select_set_add(set, in, (enum direction)7, NULL, &id_typed) == GEN_ERROR);
+    mu_assert("test_select_set: Can't add entry", select_set_add(set, typed, RECV, &value, &id_typed) == SUCCESS);
+    mu_assert("test_select_set: Can't disable entry", select_set_disable(set, id_out) == SUCCESS);
+    select_set_entry(set, id_typed)->data = NULL;
+    mu_assert("test_select_set: Testing select with a bad entry", channel_select_set(set, &selected, NULL) == GEN_ERROR);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_typed);
+    mu_assert("test_select_set: Failed set should not take a value", channel_non_blocking_send(unbuffered, "Idle") == CHANNEL_FULL);
+    mu_assert("test_select_set: Can't remove entry", select_set_remove(set, id_typed) == SUCCESS);
+    init_object_for_send_api(&send_, unbuffered, "After error", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    mu_assert("test_select_set: Testing select after an error", channel_select_set(set, &selected, NULL) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_unbuffered && send_.out == SUCCESS &&
+              string_equal(select_set_entry(set, id_unbuffered)->data, "After error"));
+    mu_assert("test_select_set: Can't close channel", channel_close(typed) == SUCCESS);
+    mu_assert("test_select_set: Can't close channel", channel_close(broadcast) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(typed) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(broadcast) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(subscription) == SUCCESS);
+
+    /* Removed ids are invalid until they are reused */
+    mu_assert("test_select_set: Can't remove entry", select_set_remove(set, id_out) == SUCCESS);
+    mu_assert("test_select_set: Removed entry should be gone", select_set_entry(set, id_out) == NULL);
+    mu_assert("test_select_set: Testing remove twice", select_set_remove(set, id_out) == GEN_ERROR);
+    mu_assert("test_select_set: Testing enable of removed entry", select_set_enable(set, id_out) == GEN_ERROR);
+    size_t id_again;
+    mu_assert("test_select_set: Can't add entry", select_set_add(set, out, SEND, "Again", &id_again) == SUCCESS);
+    mu_assert("test_select_set: Id should be reused", id_again == id_out);
+    mu_assert("test_select_set: Testing select send", channel_select_set(set, &selected, NULL) == SUCCESS);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_again);
+    mu_assert("test_select_set: Testing channel receive", channel_receive(out, &data) == SUCCESS && string_equal(data, "Again"));
+
+    /* Errors are reported with the entry that caused them */
+    mu_assert("test_select_set: Can't disable entry", select_set_disable(set, id_again) == SUCCESS);
+    mu_assert("test_select_set: Can't close channel", channel_close(unbuffered) == SUCCESS);
+    mu_assert("test_select_set: Testing select on closed channel", channel_select_set(set, &selected, NULL) == CLOSED_ERROR);
+    mu_assert("test_select_set: Wrong entry selected", selected == id_unbuffered);
+    mu_assert("test_select_set: Missing id", channel_select_set(set, NULL, NULL) == GEN_ERROR);
+
+    select_set_destroy(set);
+    mu_assert("test_select_set: Can't close channel", channel_close(in) == SUCCESS);
+    mu_assert("test_select_set: Can't close channel", channel_close(out) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(in) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(out) == SUCCESS);
+    mu_assert("test_select_set: Can't destroy channel", channel_destroy(unbuffered) == SUCCESS);
+    return NULL;
+}
+
+char* test_select_ready() {
+    print_test_details(__func__, "Testing channel select of all ready operations");
+
+    channel_t* in = channel_create(4);
+    channel_t* first = channel_create(1);
+    channel_t* second = channel_create(1);
+    select_t list[] = {{ in, RECV, NULL }, { first, SEND, "First" }, { second, SEND, "Second" }};
+    size_t completed[3];
+    size_t count = 42;
+    void* data = NULL;
+
+    /* Everything that is ready is performed in one call, each entry once */
+    mu_assert("test_select_ready: Testing channel send", channel_send(in, "In 1") == SUCCESS);
+    mu_assert("test_select_ready: Testing channel send", channel_send(in, "In 2") == SUCCESS);
+    mu_assert("test_select_ready: Testing select", channel_select_ready(list, 3, completed, 3, &count, NULL) == SUCCESS);
+    mu_assert("test_select_ready: All entries should be performed", count == 3);
+    mu_assert("test_select_ready: Wrong entries selected", completed[0] == 0 && completed[1] == 1 && completed[2] == 2);
+    mu_assert("test_select_ready: Wrong value received", string_equal(list[0].data, "In 1"));
+
+    /* At most max_completed operations are performed */
+    mu_assert("test_select_ready: Testing channel receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "First"));
+    mu_assert("test_select_ready: Testing channel receive", channel_receive(second, &data) == SUCCESS && string_equal(data, "Second"));
+    mu_assert("test_select_ready: Testing select", channel_select_ready(list, 3, completed, 2, &count, NULL) == SUCCESS);
+    mu_assert("test_select_ready: Wrong entries selected", count == 2 && completed[0] == 0 && completed[1] == 1);
+    mu_assert("test_select_ready: Wrong value received", string_equal(list[0].data, "In 2"));
+    mu_assert("test_select_ready: Testing channel receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "First"));
+
+    /* After waiting, the pass starts after the entry that woke the select */
+    pthread_t pid;
+    send_args send_;
+    init_object_for_send_api(&send_, in, "Later", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    select_t inbox[] = {{ first, SEND, "First" }, { in, RECV, NULL }};
+    mu_assert("test_select_ready: Testing channel send", channel_send(first, "Full") == SUCCESS);
+    mu_assert("test_select_ready: Testing blocked select", channel_select_ready(inbox, 2, completed, 2, &count, NULL) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_select_ready: Wrong entries selected", count == 1 && completed[0] == 1 && string_equal(inbox[1].data, "Later"));
+
+    /* Nothing ready until the deadline */
+    struct timespec deadline;
+    convertTimeToTimespec(getTime() + convertSecondsToTime(0.05), &deadline);
+    mu_assert("test_select_ready: Testing select timeout", channel_select_ready(inbox, 2, completed, 2, &count, &deadline) == TIMEOUT);
+    mu_assert("test_select_ready: Nothing should be performed", count == 0);
+
+    /* A closed channel is reported if nothing was performed, otherwise it ends the pass */
+    mu_assert("test_select_ready: Can't close channel", channel_close(in) == SUCCESS);
+    mu_assert("test_select_ready: Testing select on closed channel", channel_select_ready(list, 3, completed, 3, &count, NULL) == CLOSED_ERROR);
+    mu_assert("test_select_ready: Wrong entry selected", count == 0 && completed[0] == 0);
+    select_t outputs[] = {{ second, SEND, "Second" }, { in, RECV, NULL }};
+    mu_assert("test_select_ready: Testing select", channel_select_ready(outputs, 2, completed, 2, &count, NULL) == SUCCESS);
+    mu_assert("test_select_ready: Wrong entries selected", count == 1 && completed[0] == 0);
+    mu_assert("test_select_ready: Testing select zero max", channel_select_ready(list, 3, completed, 0, &count, NULL) == GEN_ERROR);
+    mu_assert("test_select_ready: Missing count", channel_select_ready(list, 3, completed, 3, NULL, NULL) == GEN_ERROR);
+
+    mu_assert("test_select_ready: Can't close channel", channel_close(first) == SUCCESS);
+    mu_assert("test_select_ready: Can't close channel", channel_close(second) == SUCCESS);
+    mu_assert("test_select_ready: Can't destroy channel", channel_destroy(in) == SUCCESS);
+    mu_assert("test_select_ready: Can't destroy channel", channel_destroy(first) == SUCCESS);
+    mu_assert("test_select_ready: Can't destroy channel", channel_destroy(second) == SUCCESS);
+    return NULL;
+}
+
+char* test_broadcast() {
+    print_test_details(__func__, "Testing broadcast channels");
+
+    mu_assert("test_broadcast: Broadcast needs a buffer", channel_create_broadcast(0) == NULL);
+    channel_t* broadcast = channel_create_broadcast(2);
+    mu_assert("test_broadcast: Can't create broadcast channel", broadcast != NULL);
+    mu_assert("test_broadcast: Can't subscribe to a regular channel", channel_subscribe(NULL) == NULL);
+
+    /* A value sent before anyone subscribed reaches no one */
+    mu_assert("test_broadcast: Testing send without subscriptions", channel_send(broadcast, "Nobody") == SUCCESS);
+    channel_t* first = channel_subscribe(broadcast);
+    channel_t* second = channel_subscribe(broadcast);
+    mu_assert("test_broadcast: Can't subscribe", first != NULL && second != NULL);
+    void* data = NULL;
+    mu_assert("test_broadcast: Subscription should be empty", channel_non_blocking_receive(first, &data) == CHANNEL_EMPTY);
+
+    /* Every subscription receives every value, in order */
+    mu_assert("test_broadcast: Testing channel send", channel_send(broadcast, "A") == SUCCESS);
+    mu_assert("test_broadcast: Testing channel send", channel_send(broadcast, "B") == SUCCESS);
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "A"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "B"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(second, &data) == SUCCESS && string_equal(data, "A"));
+
+    /* The slowest subscription holds the senders back */
+    mu_assert("test_broadcast: Testing channel send", channel_send(broadcast, "C") == SUCCESS);
+    mu_assert("test_broadcast: Broadcast should be full", channel_non_blocking_send(broadcast, "D") == CHANNEL_FULL);
+    pthread_t pid;
+    send_args send_;
+    init_object_for_send_api(&send_, broadcast, "D", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    usleep(100000);
+    mu_assert("test_broadcast: Sender should wait", send_.out == GEN_ERROR);
+    mu_assert("test_broadcast: Testing receive", channel_receive(second, &data) == SUCCESS && string_equal(data, "B"));
+    pthread_join(pid, NULL);
+    mu_assert("test_broadcast: Testing blocked send", send_.out == SUCCESS);
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "C"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "D"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(second, &data) == SUCCESS && string_equal(data, "C"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(second, &data) == SUCCESS && string_equal(data, "D"));
+
+    /* Each side only works in its own direction */
+    mu_assert("test_broadcast: Testing receive on broadcast", channel_non_blocking_receive(broadcast, &data) == GEN_ERROR);
+    mu_assert("test_broadcast: Testing send on subscription", channel_send(first, "Wrong") == GEN_ERROR);
+    select_t wrong[] = {{ first, SEND, "Wrong" }};
+    size_t index;
+    mu_assert("test_broadcast: Testing select send on subscription", channel_select(wrong, 1, &index) == GEN_ERROR);
+
+    /* A select on the subscriptions is woken by a send on the broadcast channel */
+    select_t list[] = {{ first, RECV, NULL }, { second, RECV, NULL }};
+    init_object_for_send_api(&send_, broadcast, "E", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    mu_assert("test_broadcast: Testing select receive", channel_select(list, 2, &index) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_broadcast: Wrong entry selected", index == 0 && string_equal(list[0].data, "E"));
+    mu_assert("test_broadcast: Testing select receive", channel_select(list, 2, &index) == SUCCESS);
+    mu_assert("test_broadcast: Wrong entry selected", index == 1 && string_equal(list[1].data, "E"));
+
+    /* A subscription that leaves no longer holds the senders back, one that joins only gets new values */
+    mu_assert("test_broadcast: Testing channel send", channel_send(broadcast, "F") == SUCCESS);
+    mu_assert("test_broadcast: Testing channel send", channel_send(broadcast, "G") == SUCCESS);
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "F"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "G"));
+    mu_assert("test_broadcast: Broadcast should be full", channel_non_blocking_send(broadcast, "H") == CHANNEL_FULL);
+    mu_assert("test_broadcast: Can't close subscription", channel_close(second) == SUCCESS);
+    mu_assert("test_broadcast: Testing receive on closed subscription", channel_receive(second, &data) == CLOSED_ERROR);
+    channel_t* third = channel_subscribe(broadcast);
+    mu_assert("test_broadcast: Can't subscribe", third != NULL);
+    mu_assert("test_broadcast: Testing send after leave", channel_non_blocking_send(broadcast, "H") == SUCCESS);
+    mu_assert("test_broadcast: Testing receive", channel_receive(first, &data) == SUCCESS && string_equal(data, "H"));
+    mu_assert("test_broadcast: Testing receive", channel_receive(third, &data) == SUCCESS && string_equal(data, "H"));
+
+    /* Closing the broadcast channel closes its subscriptions */
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, third, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(10000);
+    mu_assert("test_broadcast: Can't close channel", channel_close(broadcast) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_broadcast: Blocked receive should see close", receive_.out == CLOSED_ERROR);
+    mu_assert("test_broadcast: Subscription should be closed", channel_close(first) == CLOSED_ERROR);
+    mu_assert("test_broadcast: Can't subscribe to a closed channel", channel_subscribe(broadcast) == NULL);
+
+    mu_assert("test_broadcast: Can't destroy channel", channel_destroy(broadcast) == SUCCESS);
+    mu_assert("test_broadcast: Can't destroy subscription", channel_destroy(first) == SUCCESS);
+    mu_assert("test_broadcast: Can't destroy subscription", channel_destroy(second) == SUCCESS);
+    mu_assert("test_broadcast: Can't destroy subscription", channel_destroy(third) == SUCCESS);
+    return NULL;
+}
+
+char* test_broadcast_many() {
+    print_test_details(__func__, "Testing broadcast channels with concurrent subscriptions");
+
+    const size_t COUNT = 20000;
+    channel_t* broadcast = channel_create_broadcast(4);
+    channel_t* subscriptions[4];
+    sequence_args receivers[4];
+    pthread_t pid[4];
+    for (size_t i = 0; i < 4; i++) {
+        subscriptions[i] = channel_subscribe(broadcast);
+        init_object_for_sequence(&receivers[i], subscriptions[i], 1, COUNT);
+        pthread_create(&pid[i], NULL, i % 2 ? (void *)helper_receive_sequence_many : (void *)helper_receive_sequence, &receivers[i]);
+    }
+    sequence_args sender;
+    init_object_for_sequence(&sender, broadcast, 1, COUNT);
+    pthread_t send_pid;
+    pthread_create(&send_pid, NULL, (void *)helper_send_sequence, &sender);
+
+    /* Subscriptions joining and leaving meanwhile must neither lose values for the others nor stall the sender */
+    for (size_t i = 0; i < 200; i++) {
+        channel_t* visitor = channel_subscribe(broadcast);
+        void* data;
+        channel_non_blocking_receive(visitor, &data);
+        mu_assert("test_broadcast_many: Can't close subscription", channel_close(visitor) == SUCCESS);
+        mu_assert("test_broadcast_many: Can't destroy subscription", channel_destroy(visitor) == SUCCESS);
+    }
+
+    pthread_join(send_pid, NULL);
+    mu_assert("test_broadcast_many: Testing send sequence", sender.out == SUCCESS);
+    for (size_t i = 0; i < 4; i++) {
+        pthread_join(pid[i], NULL);
+        mu_assert("test_broadcast_many: Subscription lost or reordered values", receivers[i].out == SUCCESS);
+    }
+    mu_assert("test_broadcast_many: Can't close channel", channel_close(broadcast) == SUCCESS);
+    mu_assert("test_broadcast_many: Can't destroy channel", channel_destroy(broadcast) == SUCCESS);
+    for (size_t i = 0; i < 4; i++) {
+        mu_assert("test_broadcast_many: Can't destroy subscription", channel_destroy(subscriptions[i]) == SUCCESS);
+    }
+    return NULL;
+}
+
+char* test_conflating() {
+    print_test_details(__func__, "Testing conflating channels");
+
+    channel_t* channel = channel_create_conflating();
+    mu_assert("test_conflating: Can't create channel", channel != NULL);
+    void* data = NULL;
+    uint64_t superseded = 42;
+    mu_assert("test_conflating: Testing superseded count", channel_get_superseded(channel, &superseded) == SUCCESS && superseded == 0);
+    mu_assert("test_conflating: Channel should be empty", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+
+    /* Sends never wait and a receive gets the latest value */
+    mu_assert("test_conflating: Testing channel send", channel_send(channel, "A") == SUCCESS);
+    mu_assert("test_conflating: Testing channel send", channel_send(channel, "B") == SUCCESS);
+    mu_assert("test_conflating: Testing channel send", channel_non_blocking_send(channel, "C") == SUCCESS);
+    mu_assert("test_conflating: Testing receive", channel_receive(channel, &data) == SUCCESS && string_equal(data, "C"));
+    mu_assert("test_conflating: Channel should be empty", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+    mu_assert("test_conflating: Testing superseded count", channel_get_superseded(channel, &superseded) == SUCCESS && superseded == 2);
+
+    /* NULL is a value like any other */
+    mu_assert("test_conflating: Testing channel send", channel_send(channel, NULL) == SUCCESS);
+    data = "Not NULL";
+    mu_assert("test_conflating: Testing receive of NULL", channel_non_blocking_receive(channel, &data) == SUCCESS && data == NULL);
+
+    /* Batches keep only their last value */
+    void* items[] = { "D", "E", "F" };
+    size_t count = 0;
+    mu_assert("test_conflating: Testing send many", channel_send_many(channel, items, 3, &count) == SUCCESS && count == 3);
+    void* out[3];
+    mu_assert("test_conflating: Testing receive many", channel_receive_many(channel, out, 3, &count) == SUCCESS);
+    mu_assert("test_conflating: Only the latest value should be left", count == 1 && string_equal(out[0], "F"));
+    mu_assert("test_conflating: Testing superseded count", channel_get_superseded(channel, &superseded) == SUCCESS && superseded == 4);
+
+    /* A waiting receive or select gets the next value */
+    pthread_t pid;
+    receive_args receive_;
+    init_object_for_receive_api(&receive_, channel, NULL);
+    pthread_create(&pid, NULL, (void *)helper_receive, &receive_);
+    usleep(10000);
+    mu_assert("test_conflating: Testing channel send", channel_send(channel, "G") == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_conflating: Testing blocked receive", receive_.out == SUCCESS && string_equal(receive_.data, "G"));
+    send_args send_;
+    init_object_for_send_api(&send_, channel, "H", NULL);
+    pthread_create(&pid, NULL, (void *)helper_send, &send_);
+    select_t list[] = {{ channel, RECV, NULL }};
+    size_t index;
+    mu_assert("test_conflating: Testing select receive", channel_select(list, 1, &index) == SUCCESS);
+    pthread_join(pid, NULL);
+    mu_assert("test_conflating: Wrong value selected", index == 0 && string_equal(list[0].data, "H"));
+
+    channel_t* regular = channel_create(1);
+    mu_assert("test_conflating: Regular channels supersede nothing", channel_get_superseded(regular, &superseded) == GEN_ERROR);
+    mu_assert("test_conflating: Can't close channel", channel_close(regular) == SUCCESS);
+    mu_assert("test_conflating: Can't destroy channel", channel_destroy(regular) == SUCCESS);
+
+    mu_assert("test_conflating: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_conflating: Testing send on closed channel", channel_send(channel, "I") == CLOSED_ERROR);
+    mu_assert("test_conflating: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
+char* test_lossy() {
+    print_test_details(__func__, "Testing lossy channels");
+
+    mu_assert("test_lossy: Lossy channel needs a buffer", channel_create_lossy(0) == NULL);
+    channel_t* channel = channel_create_lossy(2);
+    mu_assert("test_lossy: Can't create channel", channel != NULL);
+    uint64_t dropped = 42;
+    void* data = NULL;
+
+    /* Sends never wait, the oldest values make room */
+    mu_assert("test_lossy: Testing channel send", channel_send(channel, "A") == SUCCESS);
+    mu_assert("test_lossy: Testing channel send", channel_send(channel, "B") == SUCCESS);
+    mu_assert("test_lossy: Testing channel send", channel_send(channel, "C") == SUCCESS);
+    mu_assert("test_lossy: Testing channel send", channel_non_blocking_send(channel, "D") == SUCCESS);
+    mu_assert("test_lossy: Testing dropped count", channel_get_dropped(channel, &dropped) == SUCCESS && dropped == 2);
+    mu_assert("test_lossy: Testing receive", channel_receive(channel, &data) == SUCCESS && string_equal(data, "C"));
+    mu_assert("test_lossy: Testing receive", channel_receive(channel, &data) == SUCCESS && string_equal(data, "D"));
+    mu_assert("test_lossy: Channel should be empty", channel_non_blocking_receive(channel, &data) == CHANNEL_EMPTY);
+
+    /* A batch keeps its newest values */
+    void* items[] = { "E", "F", "G", "H", "I" };
+    size_t count = 0;
+    mu_assert("test_lossy: Testing send many", channel_send_many(channel, items, 5, &count) == SUCCESS && count == 5);
+    void* out[5];
+    mu_assert("test_lossy: Testing receive many", channel_receive_many(channel, out, 5, &count) == SUCCESS);
+    mu_assert("test_lossy: Only the newest values should be left", count == 2 && string_equal(out[0], "H") && string_equal(out[1], "I"));
+    mu_assert("test_lossy: Testing dropped count", channel_get_dropped(channel, &dropped) == SUCCESS && dropped == 5);
+    mu_assert("test_lossy: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_lossy: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    channel_t* regular = channel_create(1);
+    mu_assert("test_lossy: Regular channels drop nothing", channel_get_dropped(regular, &dropped) == GEN_ERROR);
+    mu_assert("test_lossy: Can't close channel", channel_close(regular) == SUCCESS);
+    mu_assert("test_lossy: Can't destroy channel", channel_destroy(regular) == SUCCESS);
+
+    /* With receivers racing the drops, every value is received once or dropped, never both */
+    const size_t COUNT = 100000;
+    channel = channel_create_lossy(8);
+    atomic_int* seen = (atomic_int*)calloc(COUNT + 1, sizeof(atomic_int));
+    lossy_args receivers[2];
+    pthread_t pid[2];
+    for (size_t i = 0; i < 2; i++) {
+        receivers[i].channel = channel;
+        receivers[i].seen = seen;
+        pthread_create(&pid[i], NULL, (void *)helper_receive_lossy, &receivers[i]);
+    }
+    for (size_t i = 1; i <= COUNT; i++) {
+        mu_assert("test_lossy: Testing channel send", channel_send(channel, (void*)i) == SUCCESS);
+    }
+    /* The two newest values are never dropped, one stops each receiver */
+    mu_assert("test_lossy: Testing channel send", channel_send(channel, NULL) == SUCCESS);
+    mu_assert("test_lossy: Testing channel send", channel_send(channel, NULL) == SUCCESS);
+    size_t received = 0;
+    for (size_t i = 0; i < 2; i++) {
+        pthread_join(pid[i], NULL);
+        mu_assert("test_lossy: Values arrived out of order", receivers[i].ordered);
+        received += receivers[i].received;
+    }
+    bool duplicated = false;
+    for (size_t i = 1; i <= COUNT; i++) {
+        duplicated = duplicated || atomic_load(&seen[i]) > 1;
+    }
+    free(seen);
+    mu_assert("test_lossy: A value was received twice", !duplicated);
+    mu_assert("test_lossy: Testing dropped count", channel_get_dropped(channel, &dropped) == SUCCESS);
+    mu_assert("test_lossy: Values were lost without being counted", received + dropped == COUNT);
+    mu_assert("test_lossy: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_lossy: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
+char* test_typed() {
+    print_test_details(__func__, "Testing typed channels");
+
+    mu_assert("test_typed: Typed channel needs a buffer", channel_create_typed(0, sizeof(typed_message)) == NULL);
+    mu_assert("test_typed: Typed channel needs a value size", channel_create_typed(4, 0) == NULL);
+    channel_t* channel = channel_create_typed(2, sizeof(typed_message));
+    mu_assert("test_typed: Can't create channel", channel != NULL);
+    mu_assert("test_typed: Slots are not aligned to the cache line",
+              ((uintptr_t)channel->buffer->values % BUFFER_CACHE_LINE) == 0 && channel->buffer->stride % BUFFER_CACHE_LINE == 0);
+
+    /* Values are copied in, so the sender's copy can change right after the send */
+    typed_message message = { 1, 1, 0, "first" };
+    typed_message received;
+    mu_assert("test_typed: Testing send value", channel_send_value(channel, &message) == SUCCESS);
+    message.seq = 2;
+    strcpy(message.tag, "second");
+    mu_assert("test_typed: Testing send value", channel_non_blocking_send_value(channel, &message) == SUCCESS);
+    mu_assert("test_typed: Channel should be full", channel_non_blocking_send_value(channel, &message) == CHANNEL_FULL);
+    message.seq = 3;
+    mu_assert("test_typed: Testing receive value", channel_receive_value(channel, &received) == SUCCESS);
+    mu_assert("test_typed: Testing received value", received.seq == 1 && string_equal(received.tag, "first"));
+    mu_assert("test_typed: Testing receive value", channel_non_blocking_receive_value(channel, &received) == SUCCESS);
+    mu_assert("test_typed: Testing received value", received.seq == 2 && string_equal(received.tag, "second"));
+    mu_assert("test_typed: Channel should be empty", channel_non_blocking_receive_value(channel, &received) == CHANNEL_EMPTY);
+
+    /* Pointers and values do not mix */
+    void* data = NULL;
+    size_t count = 0;
+    mu_assert("test_typed: Pointer send on a typed channel", channel_send(channel, &message) == GEN_ERROR);
+    mu_assert("test_typed: Pointer receive on a typed channel", channel_non_blocking_receive(channel, &data) == GEN_ERROR);
+    mu_assert("test_typed: Pointer send many on a typed channel", channel_send_many(channel, &data, 1, &count) == GEN_ERROR);
+    mu_assert("test_typed: Missing value", channel_send_value(channel, NULL) == GEN_ERROR);
+    channel_t* regular = channel_create(1);
+    mu_assert("test_typed: Value send on a pointer channel", channel_send_value(regular, &message) == GEN_ERROR);
+    mu_assert("test_typed: Value receive on a pointer channel", channel_non_blocking_receive_value(regular, &received) == GEN_ERROR);
+
+    /* Select takes the address of the value in both directions */
+    select_t list[2] = { { regular, RECV, NULL }, { channel, SEND, &message } };
+    size_t index = 0;
+    mu_assert("test_typed: Testing select send", channel_select(list, 2, &index) == SUCCESS && index == 1);
+    list[1].dir = RECV;
+    list[1].data = &received;
+    mu_assert("test_typed: Testing select receive", channel_select(list, 2, &index) == SUCCESS && index == 1);
+    mu_assert("test_typed: Testing selected value", received.seq == 3 && string_equal(received.tag, "second"));
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    mu_assert("test_typed: Testing timed receive", channel_receive_value_timed(channel, &received, &deadline) == TIMEOUT);
+    mu_assert("test_typed: Can't close channel", channel_close(regular) == SUCCESS);
+    mu_assert("test_typed: Can't destroy channel", channel_destroy(regular) == SUCCESS);
+    mu_assert("test_typed: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_typed: Testing send value on closed channel", channel_send_value(channel, &message) == CLOSED_ERROR);
+    mu_assert("test_typed: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    /* Two producers and two selecting consumers through a small buffer */
+    const size_t COUNT = 100000;
+    channel = channel_create_typed(4, sizeof(typed_message));
+    typed_args producers[2];
+    typed_args consumers[2];
+    pthread_t pid[4];
+    for (size_t i = 0; i < 2; i++) {
+        consumers[i].channel = channel;
+        pthread_create(&pid[i], NULL, (void *)helper_select_typed, &consumers[i]);
+    }
+    for (size_t i = 0; i < 2; i++) {
+        producers[i].channel = channel;
+        producers[i].producer = i + 1;
+        producers[i].count = COUNT;
+        pthread_create(&pid[2 + i], NULL, (void *)helper_send_typed, &producers[i]);
+    }
+    pthread_join(pid[2], NULL);
+    pthread_join(pid[3], NULL);
+    typed_message end = { 0, 0, 0, "end" };
+    mu_assert("test_typed: Testing send value", channel_send_value(channel, &end) == SUCCESS);
+    mu_assert("test_typed: Testing send value", channel_send_value(channel, &end) == SUCCESS);
+    pthread_join(pid[0], NULL);
+    pthread_join(pid[1], NULL);
+    mu_assert("test_typed: A message was torn or out of order", consumers[0].valid && consumers[1].valid);
+    mu_assert("test_typed: Messages were lost", consumers[0].received + consumers[1].received == 2 * COUNT);
+    mu_assert("test_typed: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_typed: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
+char* test_typed_define() {
+    print_test_details(__func__, "Testing channels specialized at compile time");
+
+    channel_t* channel = count_channel_create();
+    mu_assert("test_typed_define: Can't create channel", channel != NULL);
+    mu_assert("test_typed_define: Wrong capacity", buffer_capacity(channel->buffer) == 3 && channel->buffer->elem_size == sizeof(uint64_t));
+    uint64_t value = 0;
+    for (uint64_t i = 1; i <= 3; i++) {
+        mu_assert("test_typed_define: Testing send", count_channel_non_blocking_send(channel, i) == SUCCESS);
+    }
+    mu_assert("test_typed_define: Channel should be full", count_channel_non_blocking_send(channel, 4) == CHANNEL_FULL);
+    mu_assert("test_typed_define: Testing receive", count_channel_receive(channel, &value) == SUCCESS && value == 1);
+    mu_assert("test_typed_define: Testing send", count_channel_send(channel, 4) == SUCCESS);
+    for (uint64_t i = 2; i <= 4; i++) {
+        mu_assert("test_typed_define: Testing receive", count_channel_non_blocking_receive(channel, &value) == SUCCESS && value == i);
+    }
+    mu_assert("test_typed_define: Channel should be empty", count_channel_non_blocking_receive(channel, &value) == CHANNEL_EMPTY);
+
+    /* Channels of other value sizes are refused */
+    typed_message message = { 1, 1, 0, "typed" };
+    channel_t* regular = channel_create(1);
+    mu_assert("test_typed_define: Send on a channel of another size", message_channel_send(channel, message) == GEN_ERROR);
+    mu_assert("test_typed_define: Send on a pointer channel", count_channel_send(regular, 1) == GEN_ERROR);
+    mu_assert("test_typed_define: Receive on a pointer channel", count_channel_non_blocking_receive(regular, &value) == GEN_ERROR);
+    mu_assert("test_typed_define: Missing value", count_channel_receive(channel, NULL) == GEN_ERROR);
+
+    /* Select sees the values of the inline path and the other way around */
+    select_t list[2] = { { regular, RECV, NULL }, count_channel_select(channel, RECV, &value) };
+    size_t index = 0;
+    mu_assert("test_typed_define: Testing send", count_channel_send(channel, 42) == SUCCESS);
+    mu_assert("test_typed_define: Testing select receive", channel_select(list, 2, &index) == SUCCESS && index == 1 && value == 42);
+    value = 43;
+    list[1] = count_channel_select(channel, SEND, &value);
+    mu_assert("test_typed_define: Testing select send", channel_select(list, 2, &index) == SUCCESS && index == 1);
+    mu_assert("test_typed_define: Testing receive", count_channel_receive(channel, &value) == SUCCESS && value == 43);
+    mu_assert("test_typed_define: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_typed_define: Testing send on closed channel", count_channel_send(channel, 1) == CLOSED_ERROR);
+    mu_assert("test_typed_define: Testing receive on closed channel", count_channel_receive(channel, &value) == CLOSED_ERROR);
+    mu_assert("test_typed_define: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    mu_assert("test_typed_define: Can't close channel", channel_close(regular) == SUCCESS);
+    mu_assert("test_typed_define: Can't destroy channel", channel_destroy(regular) == SUCCESS);
+
+    /* A channel of another capacity takes the out-of-line path */
+    channel = channel_create_typed(8, sizeof(uint64_t));
+    for (uint64_t i = 1; i <= 8; i++) {
+        mu_assert("test_typed_define: Testing send", count_channel_non_blocking_send(channel, i) == SUCCESS);
+    }
+    for (uint64_t i = 1; i <= 8; i++) {
+        mu_assert("test_typed_define: Testing receive", count_channel_receive(channel, &value) == SUCCESS && value == i);
+    }
+    mu_assert("test_typed_define: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_typed_define: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+
+    /* Two producers and two consumers, one receiving inline and one through select */
+    const size_t COUNT = 100000;
+    channel = message_channel_create();
+    typed_args producers[2];
+    typed_args consumers[2];
+    pthread_t pid[4];
+    consumers[0].channel = channel;
+    consumers[1].channel = channel;
+    pthread_create(&pid[0], NULL, (void *)helper_receive_defined, &consumers[0]);
+    pthread_create(&pid[1], NULL, (void *)helper_select_typed, &consumers[1]);
+    for (size_t i = 0; i < 2; i++) {
+        producers[i].channel = channel;
+        producers[i].producer = i + 1;
+        producers[i].count = COUNT;
+        pthread_create(&pid[2 + i], NULL, (void *)helper_send_defined, &producers[i]);
+    }
+    pthread_join(pid[2], NULL);
+    pthread_join(pid[3], NULL);
+    typed_message end = { 0, 0, 0, "end" };
+    mu_assert("test_typed_define: Testing send", message_channel_send(channel, end) == SUCCESS);
+    mu_assert("test_typed_define: Testing send", message_channel_send(channel, end) == SUCCESS);
+    pthread_join(pid[0], NULL);
+    pthread_join(pid[1], NULL);
+    mu_assert("test_typed_define: A message was torn or out of order", consumers[0].valid && consumers[1].valid);
+    mu_assert("test_typed_define: Messages were lost", consumers[0].received + consumers[1].received == 2 * COUNT);
+    mu_assert("test_typed_define: Can't close channel", channel_close(channel) == SUCCESS);
+    mu_assert("test_typed_define: Can't destroy channel", channel_destroy(channel) == SUCCESS);
+    return NULL;
+}
+
 typedef char* (*test_fn_t)();
 typedef struct {
     char* name;
@@ -2048,6 +3766,27 @@ test_t tests[] = {{"test_initialization", test_initialization},
                   {"test_select_mixed_buffered_unbuffered", test_select_mixed_buffered_unbuffered},
                   {"test_stress_unbuffered", test_stress_unbuffered},
                   {"test_stress_mixed_buffered_unbuffered", test_stress_mixed_buffered_unbuffered},
+                  {"test_spsc", test_spsc},
+                  {"test_mpsc", test_mpsc},
+                  {"test_send_receive_many", test_send_receive_many},
+                  {"test_wait_policies", test_wait_policies},
+                  {"test_timed", test_timed},
+                  {"test_buffer_layout", test_buffer_layout},
+                  {"test_stats", test_stats},
+                  {"test_lock_stats", test_lock_stats},
+                  {"test_registry", test_registry},
+                  {"test_latency", test_latency},
+                  {"test_trace", test_trace},
+                  {"test_select_fairness", test_select_fairness},
+                  {"test_select_non_blocking", test_select_non_blocking},
+                  {"test_select_set", test_select_set},
+                  {"test_select_ready", test_select_ready},
+                  {"test_broadcast", test_broadcast},
+                  {"test_broadcast_many", test_broadcast_many},
+                  {"test_conflating", test_conflating},
+                  {"test_lossy", test_lossy},
+                  {"test_typed", test_typed},
+                  {"test_typed_define", test_typed_define},
 };
 
 size_t num_tests = sizeof(tests)/sizeof(tests[0]);
@@ -2069,9 +3808,19 @@ char* all_tests(size_t iters) {
     return NULL;
 }
 
+// Writes the trace of the run to the file named by CHANNEL_TRACE_FILE, if set
+// Convert it with ./channel_trace_dump
+void dump_trace(void) {
+    const char* path = getenv("CHANNEL_TRACE_FILE");
+    if (path && channel_trace_dump_path(path) != SUCCESS) {
+        fprintf(stderr, "Can't write trace to %s\n", path);
+    }
+}
+
 int main(int argc, char** argv) {
     char* result = NULL;
     size_t iters = 1;
+    atexit(dump_trace);
     if (argc == 1) {
         result = all_tests(iters);
         if (result != NULL) {